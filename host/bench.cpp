@@ -0,0 +1,160 @@
+// Host benchmark runner: drives the sketch's own loop() through every mode
+// for a stretch of simulated time, one pass per millisecond like the device's
+// busy loop, and reports what each mode costs to step, how often it stepped
+// against the rate it asked for, and how many strip transmissions it needed.
+// Sketches that crossfade between modes also report their costliest frame
+// during the fade into each mode, blend and transmission included.
+//
+//   bench_<sketch> [seconds] [mode|all] [leds]
+//
+// leds runs the sketch on a strip of that length, for sketches that read it
+// at boot.
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include "bench.h"
+#include "hostsim.h"
+#include "led_strip.h"
+#include "led_scheduler.h"
+#include "led_crossfade.h"
+
+extern DirtyStrip strip;
+// Sketches without modes have no scheduler
+extern StepScheduler scheduler __attribute__((weak));
+// Nor do they crossfade
+extern Crossfade transition __attribute__((weak));
+void setup();
+void loop();
+
+// FNV-1a over every displayed frame; equal digests mean identical output
+static uint32_t hashFrame(uint32_t h)
+{
+    const uint8_t *p = hostsim::wirePixels();
+    for (uint16_t i = 0; i < hostsim::wirePixelCount() * 3; i++)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 30;
+    const char *only = argc > 2 && strcmp(argv[2], "all") != 0 ? argv[2] : nullptr;
+    if (seconds == 0)
+    {
+        seconds = 1;
+    }
+    const unsigned long passes = seconds * 1000;
+
+    if (argc > 3)
+    {
+        if (!benchStripLength)
+        {
+            fprintf(stderr, "%s has a fixed strip length\n", benchSketch);
+            return 1;
+        }
+        benchStripLength(strtoul(argv[3], nullptr, 10));
+    }
+
+    if (benchServers)
+    {
+        benchServers();
+    }
+    setup();
+    hostsim::finishOutput();
+
+    printf("%s: %lu s/mode, %u LEDs\n", benchSketch, seconds, hostsim::wirePixelCount());
+    printf("%-30s %9s %9s %7s %7s %7s %9s %9s %7s %9s %8s\n",
+           "mode", "ns/step", "max ns", "sets/s", "target", "fps", "changed/s",
+           "shows/min", "px/show", "fade max", "digest");
+
+    for (size_t m = 0; m < benchModeCount; m++)
+    {
+        const BenchMode &mode = benchModes[m];
+        if (only && strcmp(only, mode.name) != 0)
+        {
+            continue;
+        }
+        mode.enter(mode.name);
+        hostsim::resetCounters();
+        uint32_t startSteps = &scheduler ? scheduler.stepCount() : 0;
+
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t fadeMaxNs = 0;
+        uint64_t stale = 0;
+        uint32_t digest = 2166136261u;
+        for (unsigned long t = 0; t < passes; t++)
+        {
+            // Frames sent through a UART latch as time passes, not in loop()
+            uint64_t showsBefore = hostsim::counters.shows;
+            hostsim::advanceMillis(1);
+            uint64_t showNsBefore = hostsim::counters.showNs;
+            uint32_t stepsBefore = &scheduler ? scheduler.stepCount() : 0;
+            bool fading = &transition && transition.active();
+            auto t0 = std::chrono::steady_clock::now();
+            loop();
+            auto t1 = std::chrono::steady_clock::now();
+            bool showed = hostsim::counters.shows != showsBefore;
+            // Only passes that stepped the mode count towards its cost
+            if (&scheduler ? scheduler.stepCount() != stepsBefore : showed)
+            {
+                uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+                ns -= hostsim::counters.showNs - showNsBefore;
+                totalNs += ns;
+                maxNs = std::max(maxNs, ns);
+            }
+            if (fading && showed)
+            {
+                uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+                fadeMaxNs = std::max(fadeMaxNs, ns);
+            }
+            // A frame the UART was still too busy for goes out next pass
+            stale += strip.changedEnd() != 0 && !strip.showPending();
+            if (showed)
+            {
+                digest = hashFrame(digest);
+            }
+        }
+        uint64_t showsBefore = hostsim::counters.shows;
+        hostsim::finishOutput();
+        if (hostsim::counters.shows != showsBefore)
+        {
+            digest = hashFrame(digest);
+        }
+
+        const hostsim::Counters &c = hostsim::counters;
+        uint32_t steps = &scheduler ? scheduler.stepCount() - startSteps : c.shows;
+        printf("%-30s %9.0f %9llu %7.0f ", mode.name,
+               steps ? (double)totalNs / steps : 0.0,
+               (unsigned long long)maxNs,
+               (double)c.setPixelColor / seconds);
+        if (&scheduler)
+        {
+            printf("%7.1f %7.1f ", scheduler.targetFps(), scheduler.achievedFps(millis()));
+        }
+        else
+        {
+            printf("%7s %7s ", "-", "-");
+        }
+        printf("%9.0f %9.0f %7.1f ",
+               (double)c.pixelsChanged / seconds,
+               c.shows * 60.0 / seconds,
+               c.shows ? (double)c.wireBytes / 3 / c.shows : 0.0);
+        if (&transition)
+        {
+            printf("%9llu ", (unsigned long long)fadeMaxNs);
+        }
+        else
+        {
+            printf("%9s ", "-");
+        }
+        printf("%08x\n", digest);
+        if (stale)
+        {
+            printf("  !! %llu passes left rendered pixels untransmitted\n", (unsigned long long)stale);
+        }
+    }
+    return 0;
+}
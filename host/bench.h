@@ -0,0 +1,22 @@
+#pragma once
+// Mode table each sketch's bench translation unit provides to bench.cpp.
+#include <stddef.h>
+#include <stdint.h>
+
+struct BenchMode
+{
+    const char *name;
+    void (*enter)(const char *name); // switches the sketch into this mode
+};
+
+extern const char benchSketch[];
+extern const BenchMode benchModes[];
+extern const size_t benchModeCount;
+
+// Stores a strip length for the sketch to load in setup(); only sketches
+// whose length is a runtime setting define it
+void benchStripLength(uint16_t leds) __attribute__((weak));
+
+// Installs the sketch's stand-in servers before setup(); sketches that talk
+// to a server over WiFiClient define it
+void benchServers() __attribute__((weak));
@@ -0,0 +1,128 @@
+// Golden-frame check for led_strip.h's output stage at dim levels: holds
+// every pixel of a strip at one low level, at led_sketch's brightness, and
+// shows it over and over, as a mode with a constant background does.
+//
+// Rounded, as led_sketch shows modes that step too slowly to dither, the
+// wire bytes must not change at all after the first show(). Dithered, each
+// byte must average out to its exact level over 256 shows, and the number
+// of bytes at the upper wire value may only stray a little from show to
+// show: the strip as a whole must not blink. Fails if either does not
+// hold; prints a digest of every frame shown per case, which make check
+// compares against golden/dither.txt.
+//
+//   dither_check
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "hostsim.h"
+#include "led_strip.h"
+
+static constexpr uint16_t leds = 300;
+static constexpr uint8_t brightness = 50; // led_sketch's BRIGHTNESS
+static constexpr uint16_t shows = 256;
+
+DirtyStrip strip(leds, 2, NEO_GRB + NEO_KHZ800);
+
+static uint32_t hashFrame(uint32_t h)
+{
+    const uint8_t *p = hostsim::wirePixels();
+    for (uint16_t i = 0; i < leds * 3; i++)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// Shows level shows times; returns the digest, and fills in the worst
+// departures from a steady output
+static uint32_t hold(uint8_t level, bool dither, uint64_t &changed, int &worstSwing, int &worstSum)
+{
+    strip.setGammaDither(true); // starts the residue over
+    strip.setDither(dither);
+    strip.fill(grb(level, level, level));
+    strip.show();
+    hostsim::resetCounters();
+
+    // The 8.8 level every byte holds; dithered, each is at its integer part
+    // or one above
+    uint16_t exact = ((uint32_t)gamma16(level) * (brightness + 1)) >> 8;
+    static uint32_t sums[leds * 3];
+    memset(sums, 0, sizeof(sums));
+    uint32_t upper[shows];
+    uint64_t total = 0;
+    uint32_t digest = 2166136261u;
+    const uint8_t *wire = hostsim::wirePixels();
+    for (uint16_t s = 0; s < shows; s++)
+    {
+        strip.show();
+        digest = hashFrame(digest);
+        upper[s] = 0;
+        for (uint16_t i = 0; i < leds * 3; i++)
+        {
+            sums[i] += wire[i];
+            upper[s] += wire[i] > exact >> 8;
+        }
+        total += upper[s];
+    }
+    changed = hostsim::counters.pixelsChanged;
+    if (!dither)
+    {
+        return digest;
+    }
+    double mean = (double)total / shows;
+    for (uint16_t s = 0; s < shows; s++)
+    {
+        int swing = (int)lround(upper[s] - mean);
+        if (abs(swing) > abs(worstSwing))
+        {
+            worstSwing = swing;
+        }
+    }
+    // Over 256 shows a byte's wire values add up to its 8.8 level exactly
+    for (uint16_t i = 0; i < leds * 3; i++)
+    {
+        int off = (int)sums[i] - exact;
+        if (abs(off) > abs(worstSum))
+        {
+            worstSum = off;
+        }
+    }
+    return digest;
+}
+
+int main()
+{
+    strip.begin();
+    strip.setBrightness(brightness);
+
+    // A strip's bytes at the upper wire value may differ from their mean by
+    // this many from one show to the next
+    const int maxSwing = leds * 3 / 50;
+    bool ok = true;
+    printf("dither: %u LEDs at brightness %u, each level held for %u shows\n", leds, brightness, shows);
+    for (uint8_t level : {4, 12, 20, 32, 48})
+    {
+        for (bool dither : {false, true})
+        {
+            uint64_t changed = 0;
+            int swing = 0;
+            int sum = 0;
+            uint32_t digest = hold(level, dither, changed, swing, sum);
+            char name[32];
+            snprintf(name, sizeof(name), "%s-%u", dither ? "dithered" : "rounded", level);
+            printf("%-12s %08x", name, digest);
+            if (dither)
+            {
+                printf("  upper-value bytes swing %+d of %u; worst 256-show total %+d\n", swing, leds * 3, sum);
+                ok &= abs(swing) <= maxSwing && sum == 0;
+            }
+            else
+            {
+                printf("  %llu pixel changes after the first show\n", (unsigned long long)changed);
+                ok &= changed == 0;
+            }
+        }
+    }
+    printf("%s\n", ok ? "dim levels hold steady" : "UNSTEADY: a held level blinked or drifted");
+    return ok ? 0 : 1;
+}
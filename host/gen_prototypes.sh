@@ -0,0 +1,32 @@
+#!/bin/sh
+# Emits prototypes for every top-level function in a sketch, the way the
+# Arduino builder does before compiling. Sketches call their modes before
+# defining them, which a plain C++ compiler rejects. Only signatures built
+# from core types are emitted, since this header is force-included ahead of
+# anything the sketch declares itself.
+echo '#pragma once'
+echo '#include <Arduino.h>'
+awk '
+function known(t) {
+    return t ~ /^(void|bool|char|int|long|short|unsigned|signed|float|double|byte|size_t|String|const|u?int(8|16|32|64)_t)$/
+}
+/^[A-Za-z_][A-Za-z0-9_ *&]*[ *&][A-Za-z_][A-Za-z0-9_]*[ \t]*\([^;{}()]*\)[ \t]*\{?[ \t]*$/ {
+    sig = $0
+    sub(/[ \t]*\{?[ \t]*$/, "", sig)
+    head = sig; sub(/\(.*/, "", head)
+    args = sig; sub(/^[^(]*\(/, "", args); sub(/\)$/, "", args)
+    gsub(/[*&]/, " ", head)
+    n = split(head, ht, " ")
+    ok = n >= 2
+    for (i = 1; i < n; i++) if (!known(ht[i])) ok = 0
+    if (ok && args !~ /^[ \t]*(void)?[ \t]*$/) {
+        np = split(args, params, ",")
+        for (p = 1; p <= np; p++) {
+            a = params[p]; gsub(/[*&]/, " ", a)
+            na = split(a, at, " ")
+            for (i = 1; i < na; i++) if (!known(at[i])) ok = 0
+        }
+    }
+    if (ok) print sig ";"
+}
+' "$1"
@@ -0,0 +1,76 @@
+// The sketch's heap as ESP.getFreeHeap() reports it (see hostsim.h). Kept
+// apart from sim.cpp so the replaced operator new is not inlined into the
+// shims.
+#include <Arduino.h>
+#include <stdlib.h>
+#include <new>
+#include "hostsim.h"
+
+namespace hostsim
+{
+    static int sketchDepth = 0;
+    static int shimDepth = 0;
+    static int64_t sketchHeapBytes = 0;
+
+    InSketch::InSketch() { sketchDepth++; }
+    InSketch::~InSketch() { sketchDepth--; }
+    InShim::InShim() { shimDepth++; }
+    InShim::~InShim() { shimDepth--; }
+    int64_t heapBytesInUse() { return sketchHeapBytes; }
+}
+
+// Each block carries its size and whether the sketch allocated it, so a
+// free is charged back to whoever made the block
+static constexpr size_t heapHeader = 16;
+
+void *operator new(size_t size)
+{
+    uint8_t *block = (uint8_t *)malloc(size + heapHeader);
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    bool sketch = hostsim::sketchDepth > 0 && hostsim::shimDepth == 0;
+    ((size_t *)block)[0] = size;
+    ((size_t *)block)[1] = sketch;
+    if (sketch)
+    {
+        hostsim::counters.heapAllocations++;
+        hostsim::sketchHeapBytes += size;
+    }
+    return block + heapHeader;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void *p) noexcept
+{
+    if (!p)
+    {
+        return;
+    }
+    uint8_t *block = (uint8_t *)p - heapHeader;
+    if (((size_t *)block)[1])
+    {
+        hostsim::sketchHeapBytes -= ((size_t *)block)[0];
+    }
+    free(block);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { operator delete(p); }
+
+uint32_t EspClass::getFreeHeap()
+{
+    return hostsim::heapSize - (uint32_t)hostsim::sketchHeapBytes;
+}
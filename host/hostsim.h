@@ -0,0 +1,149 @@
+#pragma once
+// Host-side simulation controls. Only the shims and the bench runner include
+// this; the sketches themselves see nothing but the usual Arduino headers.
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <string>
+
+namespace hostsim
+{
+    // Virtual clock behind millis()/micros()/delay()
+    void advanceMillis(unsigned long ms);
+    void advanceMicros(unsigned long us);
+    unsigned long nowMicros();
+
+    // Payload served by the HTTPClient shim and by WiFiClient reads
+    void setHttpPayload(const char *body, int code = 200);
+    void setClientResponse(const char *body);
+
+    // One simulated TCP connection. What either end writes arrives at the
+    // other after the one-way delay, and so does a close.
+    struct Socket
+    {
+        struct Segment
+        {
+            uint64_t arrives; // micros
+            std::string bytes;
+        };
+        std::deque<Segment> toClient;
+        std::deque<Segment> toServer;
+        std::string received; // arrived at the client, not yet read
+        size_t readPos = 0;
+        uint64_t serverClosedAt = UINT64_MAX; // when the client sees the close
+        bool clientClosed = false;
+        std::string request; // the server's own use, e.g. a partial request
+        class Server *server = nullptr;
+
+        // Server side
+        void send(const std::string &bytes);
+        void close();
+    };
+
+    // A peer for the sketch's WiFiClient connections and WiFiUDP datagrams,
+    // running as simulated time passes
+    class Server
+    {
+    public:
+        virtual ~Server() = default;
+        // Whether connections and datagrams to this port are for it
+        virtual bool serves(uint16_t port) const = 0;
+        // False while the server's host is down or cut off: connection
+        // attempts then go unanswered rather than refused
+        virtual bool reachable() const { return true; }
+        // How long accepting takes, on top of the handshake's round trip
+        virtual unsigned long acceptMs() const { return 0; }
+        // The client is connecting; false refuses it
+        virtual bool accept(Socket &) { return true; }
+        // Bytes the client wrote have arrived
+        virtual void received(Socket &, const std::string &) {}
+        // The client has closed its end
+        virtual void closed(Socket &) {}
+        // A datagram from the sketch's UDP port fromPort has arrived
+        virtual void datagram(uint16_t, uint16_t, const std::string &) {}
+        // Once per pass of simulated time, after anything has arrived
+        virtual void tick() {}
+    };
+
+    // A port the sketch has opened with WiFiUDP::begin()
+    struct UdpPort
+    {
+        struct Datagram
+        {
+            uint16_t fromPort;
+            uint8_t fromHost;
+            std::string bytes;
+        };
+        uint16_t port = 0;
+        std::deque<Datagram> arrived;
+        Datagram packet; // the one parsePacket() took, being read
+        size_t readPos = 0;
+        uint16_t sendTo = 0;
+        std::string sending;
+    };
+
+    // The simulated LAN is 10.0.0.x. Every stand-in server answers at
+    // 10.0.0.serverHost, so that is where connections lead and where
+    // datagrams come from unless sent as another host.
+    constexpr uint8_t serverHost = 2;
+
+    // Server side: sends a datagram from fromPort on 10.0.0.fromHost to the
+    // sketch's toPort
+    void sendDatagram(uint16_t toPort, uint16_t fromPort, const std::string &bytes, uint8_t fromHost = serverHost);
+    // Share of datagrams lost, each way, from 0 to 1
+    void setDatagramLoss(double share);
+
+    // Connections to a port no server serves get the canned
+    // setClientResponse() reply; datagrams to one are lost
+    void addServer(Server *server);
+    void setNetworkDelay(unsigned long oneWayMicros);
+
+    // The sketch's heap: what operator new hands out while a runner holds
+    // InSketch around setup() or loop(), except inside the shims, whose
+    // workings stand in for the device's network stack and peripherals.
+    // ESP.getFreeHeap() reports heapSize less what the sketch holds.
+    // Serial.printf() allocates for output past 63 characters, as the core
+    // does.
+    constexpr uint32_t heapSize = 48 * 1024;
+    int64_t heapBytesInUse();
+
+    struct InSketch
+    {
+        InSketch();
+        ~InSketch();
+    };
+    struct InShim
+    {
+        InShim();
+        ~InShim();
+    };
+
+    // Serial output is dropped unless echo is enabled
+    void setSerialEcho(bool on);
+
+    // What the LEDs display, i.e. the bytes latched by the last show()s
+    const uint8_t *wirePixels();
+    uint16_t wirePixelCount();
+
+    // Runs simulated time until frames still going out through the UART
+    // have reached the LEDs and latched
+    void finishOutput();
+
+    struct Counters
+    {
+        uint64_t setPixelColor;  // calls, including out-of-range ones
+        uint64_t pixelsChanged;  // pixels whose wire value differed at show()
+        uint64_t shows;
+        uint64_t wireBytes;      // bytes clocked out by show()
+        uint64_t showNs;         // host time spent inside show()
+        uint64_t httpRequests;   // answered by the HTTPClient shim or a stand-in server
+        uint64_t connects;       // WiFiClient connections opened
+        uint64_t bytesSent;      // written by WiFiClients
+        uint64_t bytesReceived;  // read by them
+        uint64_t datagramsSent;  // both ways
+        uint64_t datagramsLost;
+        uint64_t heapAllocations; // made by the sketch (see InSketch)
+    };
+    extern Counters counters;
+    void resetCounters();
+}
@@ -0,0 +1,51 @@
+#pragma once
+// Adafruit_NeoPixel stand-in. Pixel storage, brightness scaling and
+// ColorHSV() follow the real library so rendered frames match the device.
+// show() latches the first numBytes bytes, like the wire protocol, and feeds
+// the hostsim counters.
+#include <Arduino.h>
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel
+{
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+    ~Adafruit_NeoPixel();
+
+    void begin() {}
+    void updateLength(uint16_t n);
+    void show();
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint32_t c);
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+    void setBrightness(uint8_t b);
+    void clear();
+    uint32_t getPixelColor(uint16_t n) const;
+    uint8_t *getPixels() const { return pixels; }
+    uint8_t getBrightness() const { return brightness - 1; }
+    uint16_t numPixels() const { return numLEDs; }
+    bool canShow() const { return true; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+    static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255);
+
+protected:
+    // Same protected members as the real library, for subclasses
+    uint16_t numLEDs;
+    uint16_t numBytes;
+    uint8_t brightness;
+    uint8_t *pixels;
+    uint8_t rOffset, gOffset, bOffset;
+
+private:
+    friend struct HostStripAccess;
+    uint8_t *lastShown; // host only: what the LEDs currently display
+};
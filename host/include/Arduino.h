@@ -0,0 +1,177 @@
+#pragma once
+// Minimal ESP8266 Arduino core stand-in for the host simulation build.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include "esp8266_peri.h"
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define A0 17
+
+#define IRAM_ATTR
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define SPECIAL 0xF8
+inline void pinMode(uint8_t, uint8_t) {}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+int analogRead(uint8_t pin);
+
+// The core's panic() prints where it was called from and resets
+#define panic() __panic_func(__FILE__, __LINE__, __func__)
+[[noreturn]] void __panic_func(const char *file, int line, const char *func);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    explicit String(char c) : s_(1, c) {}
+    explicit String(int v) : s_(std::to_string(v)) {}
+    explicit String(unsigned int v) : s_(std::to_string(v)) {}
+    explicit String(long v) : s_(std::to_string(v)) {}
+    explicit String(unsigned long v) : s_(std::to_string(v)) {}
+
+    unsigned int length() const { return s_.size(); }
+    const char *c_str() const { return s_.c_str(); }
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    void trim()
+    {
+        const char *ws = " \t\r\n";
+        size_t b = s_.find_first_not_of(ws);
+        if (b == std::string::npos)
+        {
+            s_.clear();
+            return;
+        }
+        s_ = s_.substr(b, s_.find_last_not_of(ws) - b + 1);
+    }
+    String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+            std::swap(from, to);
+        if (from >= s_.size())
+            return String();
+        return String(s_.substr(from, to - from));
+    }
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    String &operator+=(const char *o) { s_ += o; return *this; }
+    String &operator+=(char c) { s_ += c; return *this; }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator==(const char *o) const { return s_ == o; }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+    bool operator!=(const char *o) const { return s_ != o; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+
+private:
+    std::string s_;
+};
+
+class IPAddress
+{
+public:
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets_{a, b, c, d} {}
+    uint8_t operator[](int i) const { return octets_[i]; }
+    bool operator==(const IPAddress &o) const { return memcmp(octets_, o.octets_, 4) == 0; }
+    bool operator!=(const IPAddress &o) const { return !(*this == o); }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets_[0], octets_[1], octets_[2], octets_[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t octets_[4];
+};
+
+enum SerialConfig
+{
+    SERIAL_8N1 = 0x1c,
+};
+
+enum SerialMode
+{
+    SERIAL_FULL = 0,
+    SERIAL_RX_ONLY = 1,
+    SERIAL_TX_ONLY = 2,
+};
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long, SerialConfig = SERIAL_8N1, SerialMode = SERIAL_FULL) {}
+    void flush() {}
+    size_t print(const char *s);
+    size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    // Like the core, printing numbers and addresses does not allocate
+    size_t print(const IPAddress &ip) { return printf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]); }
+    size_t print(char c) { char b[2] = {c, 0}; return print(b); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    template <typename T>
+    size_t println(const T &v) { return print(v) + print("\n"); }
+    size_t println() { return print("\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    void wdtEnable(uint32_t) {}
+    void wdtFeed() {}
+    void restart();
+    uint32_t getChipId() { return 0x00C0FFEE; }
+    // The host heap does not fragment: the largest block is all that is free
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize() { return getFreeHeap(); }
+    uint8_t getHeapFragmentation() { return 0; }
+};
+extern EspClass ESP;
@@ -0,0 +1,48 @@
+#pragma once
+// Just enough of ArduinoJson 6 for flat objects of numbers and strings.
+#include <Arduino.h>
+#include <map>
+
+class DeserializationError
+{
+public:
+    enum Code
+    {
+        Ok,
+        InvalidInput
+    };
+    DeserializationError(Code c = Ok) : code_(c) {}
+    explicit operator bool() const { return code_ != Ok; }
+    const char *c_str() const { return code_ == Ok ? "Ok" : "InvalidInput"; }
+
+private:
+    Code code_;
+};
+
+class JsonVariant
+{
+public:
+    explicit JsonVariant(const std::string *v) : v_(v) {}
+    template <typename T>
+    T as() const { return v_ ? (T)strtol(v_->c_str(), nullptr, 10) : T(); }
+
+private:
+    const std::string *v_;
+};
+
+class DynamicJsonDocument
+{
+public:
+    explicit DynamicJsonDocument(size_t) {}
+    JsonVariant operator[](const char *key) const
+    {
+        auto it = fields_.find(key);
+        return JsonVariant(it == fields_.end() ? nullptr : &it->second);
+    }
+
+private:
+    friend DeserializationError deserializeJson(DynamicJsonDocument &, const String &);
+    std::map<std::string, std::string> fields_;
+};
+
+DeserializationError deserializeJson(DynamicJsonDocument &doc, const String &json);
@@ -0,0 +1,17 @@
+#pragma once
+// EEPROM stand-in backed by RAM; contents survive for the life of the process.
+#include <Arduino.h>
+
+class EEPROMClass
+{
+public:
+    void begin(size_t size);
+    uint8_t read(int address) const;
+    void write(int address, uint8_t value);
+    bool commit() { return true; }
+
+private:
+    uint8_t data_[4096] = {0};
+    size_t size_ = 0;
+};
+extern EEPROMClass EEPROM;
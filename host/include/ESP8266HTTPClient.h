@@ -0,0 +1,24 @@
+#pragma once
+// HTTPClient stand-in: GET answers with the payload set through
+// hostsim::setHttpPayload().
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient
+{
+public:
+    bool begin(WiFiClient &client, const String &url);
+    void end() {}
+    void setTimeout(uint16_t) {}
+    void setReuse(bool) {}
+    int GET();
+    String getString() { return body_; }
+    static String errorToString(int error);
+
+private:
+    String body_;
+};
@@ -0,0 +1,38 @@
+#pragma once
+// ESP8266WiFi stand-in: the station is always associated.
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1
+} WiFiMode_t;
+
+typedef enum
+{
+    WIFI_NONE_SLEEP = 0,
+    WIFI_LIGHT_SLEEP = 1
+} WiFiSleepType_t;
+
+class ESP8266WiFiClass
+{
+public:
+    wl_status_t status() { return WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    bool mode(WiFiMode_t) { return true; }
+    bool setSleepMode(WiFiSleepType_t) { return true; }
+    bool setAutoReconnect(bool) { return true; }
+    void persistent(bool) {}
+    wl_status_t begin(const char *, const char *) { return WL_CONNECTED; }
+    bool disconnect(bool = false) { return true; }
+    bool reconnect() { return true; }
+};
+extern ESP8266WiFiClass WiFi;
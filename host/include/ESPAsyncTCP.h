@@ -0,0 +1,78 @@
+#pragma once
+// ESPAsyncTCP's AsyncClient stand-in over a simulated connection to the
+// stand-in server for the port (see hostsim.h). connect() returns at once;
+// the handshake, arriving bytes and the peer's close are reported through
+// the callbacks as simulated time passes, between passes of loop() as the
+// SDK runs them on the device. A server that is down never answers, so the
+// connect only ends when the sketch gives up on it. Only what the sketches
+// use is here.
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+
+namespace hostsim
+{
+    struct Socket;
+    void runAsyncClients();
+}
+
+class AsyncClient;
+typedef std::function<void(void *, AsyncClient *)> AcConnectHandler;
+typedef std::function<void(void *, AsyncClient *, void *data, size_t len)> AcDataHandler;
+typedef std::function<void(void *, AsyncClient *, int8_t error)> AcErrorHandler;
+
+class AsyncClient
+{
+public:
+    AsyncClient();
+    ~AsyncClient();
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    bool connect(const IPAddress &ip, uint16_t port);
+    bool connect(const char *host, uint16_t port);
+    void close(bool now = false);
+    void abort();
+
+    bool connecting() const { return state_ == Connecting; }
+    bool connected() const { return state_ == Connected; }
+    bool disconnected() const { return state_ == Disconnected; }
+    bool canSend() const { return connected(); }
+    size_t space() const { return connected() ? 2920 : 0; } // two segments of send buffer
+    size_t write(const char *data, size_t size);
+    void setNoDelay(bool) {}
+    IPAddress remoteIP() const;
+
+    void onConnect(AcConnectHandler cb, void *arg = nullptr);
+    void onDisconnect(AcConnectHandler cb, void *arg = nullptr);
+    void onData(AcDataHandler cb, void *arg = nullptr);
+    void onError(AcErrorHandler cb, void *arg = nullptr);
+
+private:
+    friend void hostsim::runAsyncClients();
+
+    enum State : uint8_t
+    {
+        Disconnected,
+        Connecting,
+        Connected
+    };
+
+    // Reports what has happened by now; run by the simulation
+    void run();
+    void drop(int8_t error);
+
+    State state_ = Disconnected;
+    std::shared_ptr<hostsim::Socket> socket_;
+    uint64_t connectsAt_ = 0; // micros; UINT64_MAX while nothing answers
+    bool refused_ = false;
+
+    AcConnectHandler connectCb_;
+    void *connectArg_ = nullptr;
+    AcConnectHandler disconnectCb_;
+    void *disconnectArg_ = nullptr;
+    AcDataHandler dataCb_;
+    void *dataArg_ = nullptr;
+    AcErrorHandler errorCb_;
+    void *errorArg_ = nullptr;
+};
@@ -0,0 +1,34 @@
+#pragma once
+// WiFiClient stand-in over a simulated connection to the stand-in server
+// for the port (see hostsim.h). With none for it, every connect succeeds and
+// the peer sends the response set with hostsim::setClientResponse(), then
+// closes. Bytes take the simulated one-way delay to cross. Connecting to a
+// server blocks, as on the device, for the handshake's round trip and the
+// server's accept time, or for the timeout when it is unreachable; with no
+// server it completes at once.
+#include <Arduino.h>
+#include <memory>
+
+namespace hostsim
+{
+    struct Socket;
+}
+
+class WiFiClient
+{
+public:
+    int connect(const IPAddress &ip, uint16_t port);
+    int connect(const char *host, uint16_t port);
+    uint8_t connected();
+    int available();
+    int read();
+    int read(uint8_t *buf, size_t size);
+    size_t write(const uint8_t *buf, size_t size);
+    void stop();
+    void setTimeout(unsigned long ms) { timeout_ = ms; }
+    void setNoDelay(bool) {}
+
+private:
+    std::shared_ptr<hostsim::Socket> socket_;
+    unsigned long timeout_ = 5000; // the core's default
+};
@@ -0,0 +1,30 @@
+#pragma once
+// WiFiUDP stand-in. Datagrams go to the stand-in server for their port (see
+// hostsim.h), whatever the address, and come from the server's address
+// unless a runner sends them as another host; each takes the
+// simulated one-way delay to cross, and some share of them is lost on the way.
+#include <Arduino.h>
+#include <memory>
+
+namespace hostsim
+{
+    struct UdpPort;
+}
+
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t port);
+    void stop();
+    int parsePacket();
+    int available();
+    int read(uint8_t *buf, size_t size);
+    IPAddress remoteIP();
+    uint16_t remotePort();
+    int beginPacket(const IPAddress &ip, uint16_t port);
+    size_t write(const uint8_t *buf, size_t size);
+    int endPacket();
+
+private:
+    std::shared_ptr<hostsim::UdpPort> port_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+// UART register stand-ins, covering what led_uart.h uses. UART1 is simulated:
+// symbols written to its FIFO leave at the configured rate as simulated time
+// passes, the TX-empty interrupt fires as they do, and the TX line drives a
+// model WS2812 chain that latches into the strip's displayed pixels. UART0
+// accepts everything and sends nothing.
+#include <stdint.h>
+
+#define ESP8266_CLOCK 80000000UL
+
+#define UART0 0
+#define UART1 1
+
+// Interrupt bits
+#define UIFE 1 // TX FIFO empty
+
+// Status bits
+#define USTXC 16 // TX FIFO count (8 bits)
+
+// CONF0 bits
+#define UCTXI 22   // invert TX
+#define UCTXRST 18 // reset TX FIFO
+#define UCBS 4     // stop bits (2 bits): 1 = one
+#define UCBN 2     // data bits (2 bits): 0 = five .. 3 = eight
+
+// CONF1 bits
+#define UCFET 8 // TX FIFO empty threshold (7 bits)
+
+namespace hostsim
+{
+    struct UartRegs
+    {
+        uint32_t conf0;
+        uint32_t conf1;
+        uint32_t clkdiv;
+        uint32_t intEnable;
+    };
+    extern UartRegs uartRegs[2];
+
+    // Registers whose reads and writes the simulation acts on
+    struct UartFifo
+    {
+        int u;
+        void operator=(uint32_t symbol) const;
+    };
+    struct UartStatus
+    {
+        int u;
+        operator uint32_t() const;
+    };
+    struct UartIntStatus
+    {
+        int u;
+        operator uint32_t() const;
+    };
+    struct UartIntClear
+    {
+        int u;
+        void operator=(uint32_t) const {}
+    };
+}
+
+#define USF(u) (hostsim::UartFifo{u})
+#define USS(u) (hostsim::UartStatus{u})
+#define USIS(u) (hostsim::UartIntStatus{u})
+#define USIC(u) (hostsim::UartIntClear{u})
+#define USIE(u) (hostsim::uartRegs[u].intEnable)
+#define USC0(u) (hostsim::uartRegs[u].conf0)
+#define USC1(u) (hostsim::uartRegs[u].conf1)
+#define USD(u) (hostsim::uartRegs[u].clkdiv)
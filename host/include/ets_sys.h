@@ -0,0 +1,16 @@
+#pragma once
+// Interrupt attach stand-ins; the UART handler runs from the simulated UART
+// as its FIFO drains (see esp8266_peri.h).
+#include <Arduino.h>
+
+typedef void (*ets_isr_t)(void *);
+
+namespace hostsim
+{
+    void attachUartInterrupt(ets_isr_t handler, void *arg);
+    void enableUartInterrupt(bool on);
+}
+
+#define ETS_UART_INTR_ATTACH(func, arg) hostsim::attachUartInterrupt((ets_isr_t)(func), (void *)(arg))
+#define ETS_UART_INTR_ENABLE() hostsim::enableUartInterrupt(true)
+#define ETS_UART_INTR_DISABLE() hostsim::enableUartInterrupt(false)
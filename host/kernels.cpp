@@ -0,0 +1,108 @@
+// Host benchmark for the shared buffer kernels: times each one against the
+// per-byte loop it replaces, on a 300-pixel strip and a 3000-pixel one.
+// The per-byte loops are kept from auto-vectorizing, as on the ESP8266.
+//
+//   bench_kernels [frames]
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "led_fade.h"
+
+__attribute__((noinline, optimize("no-tree-vectorize")))
+static void fadeByBytes(uint8_t *buf, uint16_t n, uint8_t k)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        buf[i] = max(0, buf[i] - k);
+    }
+}
+
+__attribute__((noinline, optimize("no-tree-vectorize")))
+static void scaleByBytes(uint8_t *buf, uint16_t n, uint8_t keep)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        buf[i] = buf[i] * keep >> 8;
+    }
+}
+
+__attribute__((noinline))
+static void fadeByWords(uint8_t *buf, uint16_t n, uint8_t k)
+{
+    fadeBy(buf, n, k);
+}
+
+__attribute__((noinline))
+static void scaleByWords(uint8_t *buf, uint16_t n, uint8_t keep)
+{
+    scaleBy(buf, n, keep);
+}
+
+// Mean ns per call over frames calls, refilling the buffer whenever a fade
+// could have emptied it so every frame has work to do. The refill is timed
+// out of the result.
+static double timeKernel(void (*kernel)(uint8_t *, uint16_t, uint8_t), uint8_t arg, uint16_t n,
+                         unsigned long frames, uint32_t &digest)
+{
+    std::vector<uint8_t> buf(n);
+    uint64_t ns = 0;
+    uint32_t seed = 0x9E3779B9;
+    for (unsigned long f = 0; f < frames; f++)
+    {
+        if (f % 8 == 0)
+        {
+            for (uint8_t &b : buf)
+            {
+                seed = seed * 1664525 + 1013904223;
+                b = seed >> 24;
+            }
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        kernel(buf.data(), n, arg);
+        auto t1 = std::chrono::steady_clock::now();
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        for (uint8_t b : buf)
+        {
+            digest = (digest ^ b) * 16777619u;
+        }
+    }
+    return (double)ns / frames;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+    if (frames == 0)
+    {
+        frames = 1;
+    }
+    struct Kernel
+    {
+        const char *name;
+        void (*bytes)(uint8_t *, uint16_t, uint8_t);
+        void (*words)(uint8_t *, uint16_t, uint8_t);
+        uint8_t arg;
+    };
+    const Kernel kernels[] = {
+        {"fadeBy(10)", fadeByBytes, fadeByWords, 10},
+        {"scaleBy(230)", scaleByBytes, scaleByWords, 230},
+    };
+    const uint16_t lengths[] = {300, 3000};
+
+    printf("kernels: %lu frames, %u-byte words\n", frames, (unsigned)sizeof(FadeWord));
+    printf("%-14s %6s %12s %12s %8s %6s\n", "kernel", "pixels", "bytes ns", "words ns", "speedup", "same");
+    for (const Kernel &k : kernels)
+    {
+        for (uint16_t n : lengths)
+        {
+            uint32_t bytesDigest = 2166136261u;
+            uint32_t wordsDigest = 2166136261u;
+            double bytesNs = timeKernel(k.bytes, k.arg, n, frames, bytesDigest);
+            double wordsNs = timeKernel(k.words, k.arg, n, frames, wordsDigest);
+            printf("%-14s %6u %12.1f %12.1f %7.1fx %6s\n", k.name, n, bytesNs, wordsNs,
+                   wordsNs > 0 ? bytesNs / wordsNs : 0.0, bytesDigest == wordsDigest ? "yes" : "NO");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+// Bench mode table for car_leds.cpp, indexed like its EEPROM pattern counter.
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "bench.h"
+
+void setup();
+
+extern const BenchMode benchModes[];
+
+// setup() advances the stored counter by one, so store the pattern before it
+static void enterMode(const char *name)
+{
+    uint8_t pattern = 0;
+    while (strcmp(benchModes[pattern].name, name) != 0)
+    {
+        pattern++;
+    }
+    EEPROM.begin(4);
+    EEPROM.write(0, (pattern + 4) % 5);
+    setup();
+}
+
+const char benchSketch[] = "car_leds";
+
+const BenchMode benchModes[] = {
+    {"rainbow-flow", enterMode},
+    {"austere-enlightenment", enterMode},
+    {"red-burst-flow", enterMode},
+    {"proletariat-crackle", enterMode},
+    {"cosmic-rebellion-pulse", enterMode},
+};
+const size_t benchModeCount = sizeof(benchModes) / sizeof(benchModes[0]);
@@ -0,0 +1,57 @@
+// Bench mode table for led_sketch.cpp, in the server's VALID_MODES order.
+#include <stdint.h>
+#include "bench.h"
+#include "hostsim.h"
+#include "led_length.h"
+#include "modeserver.h"
+
+uint8_t findMode(const char *name);
+void applyMode(uint8_t mode);
+
+ModeServer modeServer;
+
+void benchServers()
+{
+    hostsim::addServer(&modeServer);
+}
+
+// Serve the mode from the stand-in server too, so the fetch keeps it
+static void enterMode(const char *name)
+{
+    modeServer.setMode(name);
+    applyMode(findMode(name));
+}
+
+void benchStripLength(uint16_t leds)
+{
+    saveStripLength(leds);
+}
+
+const char benchSketch[] = "led_sketch";
+
+const BenchMode benchModes[] = {
+    {"off", enterMode},
+    {"rainbow-flow", enterMode},
+    {"constant-red", enterMode},
+    {"proletariat-crackle", enterMode},
+    {"soma-haze", enterMode},
+    {"loonie-freefall", enterMode},
+    {"bokanovsky-burst", enterMode},
+    {"total-perspective-vortex", enterMode},
+    {"golgafrincham-drift", enterMode},
+    {"bistromathics-surge", enterMode},
+    {"groks-dissolution", enterMode},
+    {"newspeak-shrink", enterMode},
+    {"nolite-te-bastardes", enterMode},
+    {"infinite-improbability-drive", enterMode},
+    {"big-brother-glare", enterMode},
+    {"replicant-retirement", enterMode},
+    {"water-brother-bond", enterMode},
+    {"hypnopaedia-hum", enterMode},
+    {"vogon-poetry-pulse", enterMode},
+    {"thought-police-flash", enterMode},
+    {"electric-sheep-dream", enterMode},
+    {"random-conquest", enterMode},
+    {"red-green-conquest", enterMode},
+};
+const size_t benchModeCount = sizeof(benchModes) / sizeof(benchModes[0]);
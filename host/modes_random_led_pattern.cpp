@@ -0,0 +1,33 @@
+// Bench table for random_led_pattern.cpp. The sketch paints one pixel per
+// state: streamed from the state server while it is up, else polled from
+// the JSON server one connection at a time.
+#include "bench.h"
+#include "hostsim.h"
+#include "stateserver.h"
+
+StateServer stateServer;
+
+void benchServers()
+{
+    hostsim::addServer(&stateServer);
+}
+
+static void enterStream(const char *)
+{
+    stateServer.setOpen(true);
+}
+
+static void enterPoll(const char *)
+{
+    stateServer.setOpen(false);
+    hostsim::setClientResponse("{\"state\": 1}");
+}
+
+const char benchSketch[] = "random_led_pattern";
+
+// The stream starts connecting on the first loop(), so it runs first
+const BenchMode benchModes[] = {
+    {"state-stream", enterStream},
+    {"state-poll", enterPoll},
+};
+const size_t benchModeCount = sizeof(benchModes) / sizeof(benchModes[0]);
@@ -0,0 +1,40 @@
+// Bench mode table for sydney_leds.cpp, indexed like its EEPROM mode counter.
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "bench.h"
+
+void setup();
+
+extern const BenchMode benchModes[];
+
+// setup() advances the stored index by one, so store the mode before it
+static void enterMode(const char *name)
+{
+    uint8_t mode = 0;
+    while (strcmp(benchModes[mode].name, name) != 0)
+    {
+        mode++;
+    }
+    EEPROM.begin(1);
+    EEPROM.write(0, (mode + 12) % 13);
+    setup();
+}
+
+const char benchSketch[] = "sydney_leds";
+
+const BenchMode benchModes[] = {
+    {"off", enterMode},
+    {"red", enterMode},
+    {"green", enterMode},
+    {"blue", enterMode},
+    {"magenta", enterMode},
+    {"turquoise-camo", enterMode},
+    {"rainbow-flow", enterMode},
+    {"loonie-freefall", enterMode},
+    {"bistromathics-surge", enterMode},
+    {"groks-dissolution", enterMode},
+    {"infinite-improbability-drive", enterMode},
+    {"vogon-poetry-pulse", enterMode},
+    {"electric-sheep-dream", enterMode},
+};
+const size_t benchModeCount = sizeof(benchModes) / sizeof(benchModes[0]);
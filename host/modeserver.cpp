@@ -0,0 +1,206 @@
+// The /mode stand-in; see modeserver.h.
+#include <Arduino.h>
+#include <algorithm>
+#include <strings.h>
+#include "modeserver.h"
+
+static constexpr unsigned long maxWaitMs = 30000; // the real server's cap
+static constexpr uint16_t udpPort = 4211;          // pushes come from here
+
+void ModeServer::setMode(const char *m)
+{
+    mode = m;
+    version++;
+    if (pushPort)
+    {
+        pushSeq++;
+        pushesLeft = pushTries;
+        nextPush = millis();
+    }
+}
+
+void ModeServer::setDown(bool d)
+{
+    down = d;
+    if (down)
+    {
+        held.clear();
+        late.clear();
+        pushesLeft = 0;
+    }
+}
+
+bool ModeServer::serves(uint16_t port) const
+{
+    return port == httpPort || port == udpPort;
+}
+
+void ModeServer::received(hostsim::Socket &socket, const std::string &bytes)
+{
+    if (down)
+    {
+        return;
+    }
+    socket.request += bytes;
+    size_t end;
+    while ((end = socket.request.find("\r\n\r\n")) != std::string::npos)
+    {
+        std::string request = socket.request.substr(0, end + 2);
+        socket.request.erase(0, end + 4);
+        counts.requests++;
+        hostsim::counters.httpRequests++;
+
+        unsigned long waitMs = 0;
+        size_t wait = request.find("?wait=");
+        if (wait != std::string::npos && wait < request.find("\r\n"))
+        {
+            waitMs = std::min(strtoul(request.c_str() + wait + 6, nullptr, 10) * 1000, maxWaitMs);
+        }
+        std::string ifNoneMatch;
+        for (size_t line = request.find("\r\n") + 2; line < request.size();)
+        {
+            size_t next = request.find("\r\n", line);
+            if (strncasecmp(request.c_str() + line, "If-None-Match:", 14) == 0)
+            {
+                size_t value = request.find_first_not_of(' ', line + 14);
+                ifNoneMatch = request.substr(value, next - value);
+            }
+            line = next + 2;
+        }
+        answer(socket, ifNoneMatch, waitMs);
+    }
+}
+
+void ModeServer::answer(hostsim::Socket &socket, const std::string &ifNoneMatch, unsigned long waitMs)
+{
+    if (legacy || ifNoneMatch != etag())
+    {
+        reply(socket, true);
+    }
+    else if (waitMs)
+    {
+        counts.held++;
+        held.push_back({&socket, ifNoneMatch, millis() + waitMs});
+    }
+    else
+    {
+        reply(socket, false);
+    }
+}
+
+void ModeServer::reply(hostsim::Socket &socket, bool changed)
+{
+    std::string response;
+    if (legacy)
+    {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: " +
+                   std::to_string(mode.size()) + "\r\n\r\n" + mode;
+        send(socket, response, true);
+        return;
+    }
+    if (changed)
+    {
+        response = "HTTP/1.1 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: " +
+                   std::to_string(mode.size()) + "\r\nETag: " + etag() + "\r\n\r\n" + mode;
+    }
+    else
+    {
+        counts.notModified++;
+        response = "HTTP/1.1 304 NOT MODIFIED\r\nETag: " + etag() + "\r\n\r\n";
+    }
+    send(socket, response, false);
+}
+
+void ModeServer::send(hostsim::Socket &socket, const std::string &response, bool close)
+{
+    if (slowMs)
+    {
+        late.push_back({&socket, response, close, millis() + slowMs});
+        return;
+    }
+    socket.send(response);
+    if (close)
+    {
+        socket.close();
+    }
+}
+
+void ModeServer::closed(hostsim::Socket &socket)
+{
+    held.erase(std::remove_if(held.begin(), held.end(), [&](const Held &h) { return h.socket == &socket; }),
+               held.end());
+    late.erase(std::remove_if(late.begin(), late.end(), [&](const Late &l) { return l.socket == &socket; }),
+               late.end());
+}
+
+void ModeServer::push()
+{
+    std::string datagram = {'L', 'M', 1, (char)pushSeq, (char)(pushSeq >> 8), (char)(pushSeq >> 16),
+                            (char)(pushSeq >> 24)};
+    datagram += {(char)version, (char)(version >> 8), (char)(version >> 16), (char)(version >> 24)};
+    hostsim::sendDatagram(pushPort, udpPort, datagram + mode);
+    counts.pushes++;
+    if (--pushesLeft == 0)
+    {
+        counts.gaveUp++;
+    }
+}
+
+void ModeServer::datagram(uint16_t, uint16_t, const std::string &bytes)
+{
+    if (bytes.size() < 8 || bytes[0] != 'L' || bytes[1] != 'M' || bytes[2] != 2)
+    {
+        return;
+    }
+    uint32_t seq = (uint8_t)bytes[3] | (uint8_t)bytes[4] << 8 | (uint8_t)bytes[5] << 16 |
+                   (uint32_t)(uint8_t)bytes[6] << 24;
+    if (seq == pushSeq && pushesLeft)
+    {
+        counts.acked++;
+        pushesLeft = 0;
+    }
+}
+
+void ModeServer::tick()
+{
+    if (down)
+    {
+        return;
+    }
+    unsigned long now = millis();
+    for (size_t i = 0; i < late.size();)
+    {
+        if ((long)(now - late[i].due) >= 0)
+        {
+            late[i].socket->send(late[i].response);
+            if (late[i].close)
+            {
+                late[i].socket->close();
+            }
+            late.erase(late.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    if (pushesLeft && (long)(now - nextPush) >= 0)
+    {
+        push();
+        nextPush = now + pushRetryMs;
+    }
+    std::string current = etag();
+    for (size_t i = 0; i < held.size();)
+    {
+        bool changed = held[i].etag != current;
+        if (changed || (long)(now - held[i].deadline) >= 0)
+        {
+            reply(*held[i].socket, changed);
+            held.erase(held.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
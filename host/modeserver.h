@@ -0,0 +1,92 @@
+#pragma once
+// Stand-in for the /mode endpoint of led_strips_server.py, served over the
+// simulated network. The ETag is the quoted version and mode, the version
+// rising with every change; a request whose
+// If-None-Match still matches is held for up to its ?wait= seconds and
+// answered when the mode changes, or with 304 once the wait is up. Keeps the
+// connection open between requests (HTTP/1.1).
+//
+// With legacy set it answers like the server before conditional requests:
+// 200 with the mode every time, over HTTP/1.0, closing after each reply.
+//
+// With pushPort set it also pushes each change to that UDP port (see
+// led_modepush.h), resending every pushRetryMs until acked.
+//
+// slowMs makes it a slow server: it takes that long to accept a connection
+// and to answer each request. setDown(true) takes its host off the network:
+// connection attempts go unanswered, and so do requests on connections it
+// had, until setDown(false).
+#include <string>
+#include <vector>
+#include "hostsim.h"
+
+class ModeServer : public hostsim::Server
+{
+public:
+    uint16_t httpPort = 8080; // led_sketch's serverPort
+    bool legacy = false;
+    uint16_t pushPort = 0;
+    unsigned long pushRetryMs = 100;
+    uint8_t pushTries = 20;
+    unsigned long slowMs = 0;
+
+    struct Stats
+    {
+        uint64_t requests;
+        uint64_t held;     // requests that waited for a change or the timeout
+        uint64_t notModified;
+        uint64_t pushes;   // datagrams sent, resends included
+        uint64_t acked;    // changes the strip confirmed
+        uint64_t gaveUp;   // changes never acked
+    };
+
+    // Held requests are answered, and the push sent, on the next tick
+    void setMode(const char *m);
+    const Stats &stats() const { return counts; }
+    void resetStats() { counts = Stats(); }
+
+    // Whatever it held or had yet to send is lost
+    void setDown(bool d);
+
+    bool serves(uint16_t port) const override;
+    bool reachable() const override { return !down; }
+    unsigned long acceptMs() const override { return slowMs; }
+    void received(hostsim::Socket &socket, const std::string &bytes) override;
+    void closed(hostsim::Socket &socket) override;
+    void datagram(uint16_t fromPort, uint16_t toPort, const std::string &bytes) override;
+    void tick() override;
+
+private:
+    struct Held
+    {
+        hostsim::Socket *socket;
+        std::string etag;
+        unsigned long deadline; // millis
+    };
+
+    struct Late
+    {
+        hostsim::Socket *socket;
+        std::string response;
+        bool close;
+        unsigned long due; // millis
+    };
+
+    void answer(hostsim::Socket &socket, const std::string &etag, unsigned long waitMs);
+    void reply(hostsim::Socket &socket, bool changed);
+    void send(hostsim::Socket &socket, const std::string &response, bool close);
+    void push();
+    std::string etag() const { return "\"" + std::to_string(version) + "-" + mode + "\""; }
+
+    std::string mode = "off";
+    uint32_t version = 1000;
+    std::vector<Held> held;
+    std::vector<Late> late; // replies a slow server has yet to send
+    bool down = false;
+
+    // The change being pushed
+    uint32_t pushSeq = 0;
+    uint8_t pushesLeft = 0;
+    unsigned long nextPush = 0;
+    Stats counts = {};
+};
@@ -0,0 +1,233 @@
+// Mode fetch runner: runs led_sketch against the stand-in mode server for
+// hours of simulated time, changing the served mode every so often the way
+// someone at the web page would, and reports what fetching the mode costs per
+// hour, how long each change took to reach the strip, whether loop()
+// touched the heap while it ran, and whether any pass of loop() held up the
+// animation for longer than a frame.
+//
+//   poll_led_sketch [hours] [changes/hour] [legacy] [push] [loss=percent]
+//                   [slow=ms] [down=seconds] [spoof]
+//
+// legacy serves the mode the way the server did before conditional requests,
+// which leaves the fetch polling. push also pushes each change over UDP,
+// losing that percentage of datagrams each way. slow makes the server take
+// that long to accept and to answer; down takes it off the network for that
+// long, a third of the way into the run. spoof has another host on the LAN
+// push a mode and a strip length to the sketch every few minutes, which it
+// must drop: the run fails if any of those is taken.
+#include <Arduino.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "bench.h"
+#include "hostsim.h"
+#include "modeserver.h"
+#include "led_modepush.h"
+#include "led_scheduler.h"
+
+extern ModeServer modeServer;
+extern ModePush modePush;
+extern StepScheduler scheduler;
+extern uint8_t currentMode;
+uint8_t findMode(const char *name);
+void setup();
+void loop();
+
+int main(int argc, char **argv)
+{
+    unsigned long hours = std::max(argc > 1 ? strtoul(argv[1], nullptr, 10) : 1, 1UL);
+    unsigned long perHour = std::max(argc > 2 ? strtoul(argv[2], nullptr, 10) : 12, 1UL);
+    bool push = false;
+    double loss = 0;
+    unsigned long downMs = 0;
+    bool spoof = false;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "legacy") == 0)
+        {
+            modeServer.legacy = true;
+        }
+        else if (strcmp(argv[i], "push") == 0)
+        {
+            push = true;
+        }
+        else if (strncmp(argv[i], "loss=", 5) == 0)
+        {
+            loss = atof(argv[i] + 5) / 100;
+        }
+        else if (strncmp(argv[i], "slow=", 5) == 0)
+        {
+            modeServer.slowMs = strtoul(argv[i] + 5, nullptr, 10);
+        }
+        else if (strncmp(argv[i], "down=", 5) == 0)
+        {
+            downMs = strtoul(argv[i] + 5, nullptr, 10) * 1000;
+        }
+        else if (strcmp(argv[i], "spoof") == 0)
+        {
+            spoof = true;
+        }
+    }
+    hostsim::setDatagramLoss(loss);
+
+    benchServers();
+    {
+        hostsim::InSketch sketch;
+        setup();
+    }
+    if (push)
+    {
+        modeServer.pushPort = modePush.port();
+    }
+    hostsim::resetCounters();
+    modeServer.resetStats();
+
+    // Changes come at random, between half and one and a half times the mean
+    // spacing apart, cycling through the modes
+    uint32_t seed = 2463534242u;
+    auto nextRandom = [&seed]()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+    const unsigned long meanMs = 3600000UL / perHour;
+    const unsigned long end = millis() + hours * 3600000UL;
+    const unsigned long downAt = millis() + hours * 3600000UL / 3;
+    unsigned long nextChange = millis() + meanMs / 2 + nextRandom() % meanMs;
+    size_t nextMode = 1;
+
+    bool pending = false;
+    uint8_t target = 0;
+    unsigned long changedAt = 0;
+    std::vector<unsigned long> latencies;
+    unsigned changes = 0;
+    unsigned superseded = 0; // changed again before the strip caught up
+    uint64_t allocations = 0; // by loop()
+    int64_t heldAfterSetup = hostsim::heapBytesInUse();
+    uint32_t lowestFree = ESP.getFreeHeap();
+    unsigned long longestPass = 0;
+    unsigned longPasses = 0; // longer than the mode's frame interval
+    const unsigned long spoofMs = 5 * 60000UL;
+    unsigned long nextSpoof = millis() + spoofMs;
+    uint32_t spoofSeq = 0x40000000;
+    unsigned spoofs = 0;
+    uint32_t strangersBefore = modePush.stats().strangers;
+    while (millis() < end)
+    {
+        if (spoof && (long)(millis() - nextSpoof) >= 0)
+        {
+            // Sequence numbers well ahead of the server's, as a replay or a
+            // forgery would use to be taken
+            for (char type : {ModePush::ModeChange, ModePush::StripLength})
+            {
+                spoofSeq++;
+                std::string datagram = {'L', 'M', type, (char)spoofSeq, (char)(spoofSeq >> 8),
+                                        (char)(spoofSeq >> 16), (char)(spoofSeq >> 24)};
+                if (type == ModePush::ModeChange)
+                {
+                    datagram += std::string("\xff\xff\xff\x7f") + benchModes[0].name;
+                }
+                else
+                {
+                    datagram += "\x58\x02";
+                }
+                hostsim::sendDatagram(modePush.port(), 4211, datagram, 9);
+                spoofs++;
+            }
+            nextSpoof += spoofMs;
+        }
+        if (downMs && millis() >= downAt)
+        {
+            modeServer.setDown(millis() < downAt + downMs);
+        }
+        hostsim::advanceMillis(1);
+        uint64_t allocationsBefore = hostsim::counters.heapAllocations;
+        float fps = scheduler.targetFps();
+        unsigned long passStart = millis();
+        {
+            hostsim::InSketch sketch;
+            loop();
+        }
+        allocations += hostsim::counters.heapAllocations - allocationsBefore;
+        lowestFree = std::min(lowestFree, ESP.getFreeHeap());
+        unsigned long now = millis();
+        longestPass = std::max(longestPass, now - passStart);
+        longPasses += fps > 0 && now - passStart > 1000 / fps;
+        if (pending && currentMode == target)
+        {
+            latencies.push_back(now - changedAt);
+            pending = false;
+        }
+        if ((long)(now - nextChange) >= 0)
+        {
+            superseded += pending;
+            const char *name = benchModes[nextMode].name;
+            nextMode = (nextMode + 1) % benchModeCount;
+            modeServer.setMode(name);
+            target = findMode(name);
+            changedAt = now;
+            pending = true;
+            changes++;
+            nextChange = now + meanMs / 2 + nextRandom() % meanMs;
+        }
+    }
+
+    const hostsim::Counters &c = hostsim::counters;
+    const ModeServer::Stats &s = modeServer.stats();
+    printf("%s mode fetch: %lu h against the %s%s server%s, %u changes", benchSketch, hours,
+           modeServer.slowMs ? "slow " : "", modeServer.legacy ? "legacy" : "long-poll",
+           modeServer.pushPort ? " with pushes" : "", changes);
+    if (modeServer.slowMs)
+    {
+        printf(", %lu ms to accept and answer", modeServer.slowMs);
+    }
+    if (downMs)
+    {
+        printf(", down for %lu s", downMs / 1000);
+    }
+    printf("\n");
+    printf("per hour: %.0f requests (%.0f held, %.0f not modified), %.0f connects, "
+           "%.0f B sent, %.0f B received\n",
+           (double)s.requests / hours, (double)s.held / hours, (double)s.notModified / hours,
+           (double)c.connects / hours, (double)c.bytesSent / hours, (double)c.bytesReceived / hours);
+    if (modeServer.pushPort)
+    {
+        printf("pushes: %llu datagrams for %u changes, %llu acked, %llu given up; "
+               "%u taken, %u duplicates dropped; %.0f%% lost each way (%llu of %llu)\n",
+               (unsigned long long)s.pushes, changes, (unsigned long long)s.acked, (unsigned long long)s.gaveUp,
+               modePush.stats().changes, modePush.stats().duplicates, loss * 100,
+               (unsigned long long)c.datagramsLost, (unsigned long long)c.datagramsSent);
+    }
+    uint32_t spoofsDropped = modePush.stats().strangers - strangersBefore;
+    if (spoof)
+    {
+        printf("impostor at 10.0.0.9: %u pushes, %u dropped unacked\n", spoofs, spoofsDropped);
+    }
+    printf("sketch heap: %llu allocations in loop(); %lld B held after setup, %lld B now, %u B free at lowest\n",
+           (unsigned long long)allocations, (long long)heldAfterSetup, (long long)hostsim::heapBytesInUse(),
+           lowestFree);
+    printf("frame pacing: longest loop() pass %lu ms; %u passes longer than the mode's frame interval\n",
+           longestPass, longPasses);
+    if (spoof && spoofsDropped < spoofs)
+    {
+        printf("impostor: a push from another host was taken\n");
+        return 1;
+    }
+    if (latencies.empty())
+    {
+        printf("switch latency: no change reached the strip\n");
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    unsigned long total = 0;
+    for (unsigned long ms : latencies)
+    {
+        total += ms;
+    }
+    printf("switch latency: mean %lu ms, median %lu ms, max %lu ms; %u superseded, %u still pending\n",
+           total / latencies.size(), latencies[latencies.size() / 2], latencies.back(), superseded,
+           (unsigned)pending);
+    return 0;
+}
@@ -0,0 +1,1172 @@
+// Host implementations behind the shim headers in include/.
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#include <WiFiUdp.h>
+#include <EEPROM.h>
+#include <ESPAsyncTCP.h>
+#include <ets_sys.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "hostsim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+EEPROMClass EEPROM;
+
+namespace hostsim
+{
+    Counters counters;
+
+    static uint64_t clockMicros = 0;
+    static bool serialEcho = false;
+    static std::string httpPayload = "off";
+    static int httpCode = HTTP_CODE_OK;
+    static std::string clientResponse;
+
+    static void runUart1();
+    static void runNetwork();
+
+    void advanceMillis(unsigned long ms)
+    {
+        InShim shim;
+        clockMicros += (uint64_t)ms * 1000;
+        runUart1();
+        runNetwork();
+    }
+    void advanceMicros(unsigned long us)
+    {
+        InShim shim;
+        clockMicros += us;
+        runUart1();
+        runNetwork();
+    }
+    unsigned long nowMicros() { return (unsigned long)clockMicros; }
+
+    void setHttpPayload(const char *body, int code)
+    {
+        httpPayload = body;
+        httpCode = code;
+    }
+    void setClientResponse(const char *body) { clientResponse = body; }
+    void setSerialEcho(bool on) { serialEcho = on; }
+    void resetCounters() { counters = Counters(); }
+
+    bool echo() { return serialEcho; }
+}
+
+struct HostStripAccess
+{
+    static Adafruit_NeoPixel *current;
+    static uint8_t *wire() { return current->lastShown; }
+    static uint16_t count() { return current->numLEDs; }
+
+    // The LEDs take the first count bytes; later pixels keep their colors
+    static void latch(const uint8_t *bytes, uint16_t count)
+    {
+        uint16_t kept = std::min<uint16_t>(count, current->numBytes);
+        hostsim::counters.shows++;
+        hostsim::counters.wireBytes += count;
+        for (uint16_t i = 0; i < kept / 3; i++)
+        {
+            if (memcmp(&bytes[i * 3], &current->lastShown[i * 3], 3) != 0)
+            {
+                hostsim::counters.pixelsChanged++;
+            }
+        }
+        memcpy(current->lastShown, bytes, kept);
+    }
+};
+Adafruit_NeoPixel *HostStripAccess::current = nullptr;
+
+namespace hostsim
+{
+    const uint8_t *wirePixels() { return HostStripAccess::wire(); }
+    uint16_t wirePixelCount() { return HostStripAccess::count(); }
+}
+
+// ---- Time ----
+
+unsigned long millis() { return (unsigned long)(hostsim::nowMicros() / 1000); }
+unsigned long micros() { return hostsim::nowMicros(); }
+void delay(unsigned long ms) { hostsim::advanceMillis(ms); }
+void delayMicroseconds(unsigned int us) { hostsim::advanceMicros(us); }
+void yield() {}
+int analogRead(uint8_t) { return 512; }
+
+// ---- WMath, using newlib's rand() generator like the ESP8266 toolchain ----
+
+static uint64_t randNext = 1;
+
+static long nextRand()
+{
+    randNext = randNext * 6364136223846793005ULL + 1;
+    return (long)((randNext >> 32) & 0x7fffffff);
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+    {
+        randNext = seed;
+    }
+}
+
+long random(long howbig)
+{
+    if (howbig == 0)
+    {
+        return 0;
+    }
+    return nextRand() % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+    return random(howbig - howsmall) + howsmall;
+}
+
+// ---- Serial / ESP ----
+
+size_t HardwareSerial::print(const char *s)
+{
+    if (hostsim::echo())
+    {
+        fputs(s, stderr);
+    }
+    return strlen(s);
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...)
+{
+    // Like the core: formats into 64 bytes on the stack, and allocates for more
+    char buf[64];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < (int)sizeof(buf))
+    {
+        print(buf);
+        return n < 0 ? 0 : (size_t)n;
+    }
+    char *big = new char[n + 1];
+    va_start(ap, fmt);
+    vsnprintf(big, n + 1, fmt, ap);
+    va_end(ap);
+    print(big);
+    delete[] big;
+    return n;
+}
+
+void __panic_func(const char *file, int line, const char *func)
+{
+    fprintf(stderr, "panic at %s:%d %s() at %lu ms\n", file, line, func, millis());
+    exit(3);
+}
+
+void EspClass::restart()
+{
+    fprintf(stderr, "ESP.restart() called at %lu ms\n", millis());
+    exit(2);
+}
+
+// ---- Adafruit_NeoPixel ----
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t, neoPixelType type)
+    : numLEDs(n), numBytes(n * 3), brightness(0)
+{
+    pixels = (uint8_t *)calloc(numBytes, 1);
+    lastShown = (uint8_t *)calloc(numBytes, 1);
+    HostStripAccess::current = this;
+    rOffset = (type >> 4) & 0b11;
+    gOffset = (type >> 2) & 0b11;
+    bOffset = type & 0b11;
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+    free(pixels);
+    free(lastShown);
+}
+
+void Adafruit_NeoPixel::updateLength(uint16_t n)
+{
+    free(pixels);
+    free(lastShown);
+    numLEDs = n;
+    numBytes = n * 3;
+    pixels = (uint8_t *)calloc(numBytes, 1);
+    lastShown = (uint8_t *)calloc(numBytes, 1);
+}
+
+void Adafruit_NeoPixel::show()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    // Only the first numBytes are clocked out
+    HostStripAccess::latch(pixels, numBytes);
+    auto t1 = std::chrono::steady_clock::now();
+    hostsim::counters.showNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+    hostsim::counters.setPixelColor++;
+    if (n < numLEDs)
+    {
+        if (brightness)
+        {
+            r = (r * brightness) >> 8;
+            g = (g * brightness) >> 8;
+            b = (b * brightness) >> 8;
+        }
+        uint8_t *p = &pixels[n * 3];
+        p[rOffset] = r;
+        p[gOffset] = g;
+        p[bOffset] = b;
+    }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c)
+{
+    setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+}
+
+void Adafruit_NeoPixel::fill(uint32_t c, uint16_t first, uint16_t count)
+{
+    if (first >= numLEDs)
+    {
+        return;
+    }
+    uint16_t end = (count == 0) ? numLEDs : first + count;
+    if (end > numLEDs)
+    {
+        end = numLEDs;
+    }
+    for (uint16_t i = first; i < end; i++)
+    {
+        setPixelColor(i, c);
+    }
+}
+
+void Adafruit_NeoPixel::setBrightness(uint8_t b)
+{
+    uint8_t newBrightness = b + 1;
+    if (newBrightness != brightness)
+    {
+        uint8_t oldBrightness = brightness - 1;
+        uint16_t scale;
+        if (oldBrightness == 0)
+        {
+            scale = 0;
+        }
+        else if (b == 255)
+        {
+            scale = 65535 / oldBrightness;
+        }
+        else
+        {
+            scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
+        }
+        for (uint16_t i = 0; i < numBytes; i++)
+        {
+            pixels[i] = (pixels[i] * scale) >> 8;
+        }
+        brightness = newBrightness;
+    }
+}
+
+void Adafruit_NeoPixel::clear()
+{
+    memset(pixels, 0, numBytes);
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const
+{
+    if (n >= numLEDs)
+    {
+        return 0;
+    }
+    const uint8_t *p = &pixels[n * 3];
+    uint8_t r = p[rOffset], g = p[gOffset], b = p[bOffset];
+    if (brightness)
+    {
+        r = (r << 8) / brightness;
+        g = (g << 8) / brightness;
+        b = (b << 8) / brightness;
+    }
+    return Color(r, g, b);
+}
+
+uint32_t Adafruit_NeoPixel::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val)
+{
+    uint8_t r, g, b;
+    hue = (hue * 1530L + 32768) / 65536;
+    if (hue < 510)
+    {
+        b = 0;
+        if (hue < 255)
+        {
+            r = 255;
+            g = hue;
+        }
+        else
+        {
+            r = 510 - hue;
+            g = 255;
+        }
+    }
+    else if (hue < 1020)
+    {
+        r = 0;
+        if (hue < 765)
+        {
+            g = 255;
+            b = hue - 510;
+        }
+        else
+        {
+            g = 1020 - hue;
+            b = 255;
+        }
+    }
+    else if (hue < 1530)
+    {
+        g = 0;
+        if (hue < 1275)
+        {
+            r = hue - 1020;
+            b = 255;
+        }
+        else
+        {
+            r = 255;
+            b = 1530 - hue;
+        }
+    }
+    else
+    {
+        r = 255;
+        g = b = 0;
+    }
+    uint32_t v1 = 1 + val;
+    uint16_t s1 = 1 + sat;
+    uint8_t s2 = 255 - sat;
+    return ((((((r * s1) >> 8) + s2) * v1) & 0xff00) << 8) |
+           (((((g * s1) >> 8) + s2) * v1) & 0xff00) |
+           (((((b * s1) >> 8) + s2) * v1) >> 8);
+}
+
+// ---- UART1 driving a WS2812 chain ----
+
+namespace hostsim
+{
+    UartRegs uartRegs[2];
+
+    static ets_isr_t uartHandler = nullptr;
+    static void *uartHandlerArg = nullptr;
+    static bool uartInterrupts = false;
+    static bool inUartHandler = false;
+
+    static constexpr size_t uartFifoSize = 128;
+    static std::deque<uint8_t> uart1Fifo;
+    static uint64_t uart1LineFree = 0; // 80 MHz tick at which the line is free
+
+    static uint64_t nowTicks() { return clockMicros * 80; }
+
+    // A WS2812 reads each bit from how long the line stays high, and latches
+    // what it has shifted in once the line has been low long enough
+    struct Ws2812Chain
+    {
+        static constexpr uint64_t oneTicks = 50;     // high 625 ns or more is a 1
+        static constexpr uint64_t resetTicks = 4000; // low 50 us latches
+
+        uint64_t highTicks = 0;
+        uint64_t lowTicks = 0;
+        uint8_t shift = 0;
+        uint8_t bits = 0;
+        std::vector<uint8_t> bytes;
+
+        void level(bool high, uint64_t ticks)
+        {
+            if (high)
+            {
+                lowTicks = 0;
+                highTicks += ticks;
+                return;
+            }
+            if (highTicks)
+            {
+                shift = shift << 1 | (highTicks >= oneTicks);
+                highTicks = 0;
+                if (++bits == 8)
+                {
+                    bytes.push_back(shift);
+                    bits = 0;
+                }
+            }
+            lowTicks += ticks;
+            if (lowTicks >= resetTicks && (!bytes.empty() || bits))
+            {
+                HostStripAccess::latch(bytes.data(), bytes.size());
+                bytes.clear();
+                bits = 0;
+            }
+        }
+    };
+    static Ws2812Chain chain;
+
+    static bool uart1Inverted() { return uartRegs[1].conf0 & (1UL << UCTXI); }
+
+    // Puts one symbol on the line, merging runs of equal bits
+    static void sendSymbol(uint8_t symbol, uint64_t bitTicks)
+    {
+        uint8_t dataBits = 5 + ((uartRegs[1].conf0 >> UCBN) & 3);
+        uint8_t stopBits = ((uartRegs[1].conf0 >> UCBS) & 3) == 3 ? 2 : 1;
+        bool invert = uart1Inverted();
+        bool run = invert; // start bit is a 0
+        uint64_t runTicks = bitTicks;
+        for (uint8_t b = 0; b < dataBits + stopBits; b++)
+        {
+            bool bit = (b < dataBits ? (symbol >> b) & 1 : 1) != invert;
+            if (bit == run)
+            {
+                runTicks += bitTicks;
+                continue;
+            }
+            chain.level(run, runTicks);
+            run = bit;
+            runTicks = bitTicks;
+        }
+        chain.level(run, runTicks);
+    }
+
+    static bool uart1WantsRefill()
+    {
+        uint32_t threshold = (uartRegs[1].conf1 >> UCFET) & 0x7F;
+        return uartInterrupts && uartHandler && !inUartHandler && (uartRegs[1].intEnable & (1UL << UIFE)) &&
+               uart1Fifo.size() <= threshold;
+    }
+
+    // Sends every symbol that has finished by now, raising the TX-empty
+    // interrupt as the FIFO drains, then idles the line up to now
+    static void runUart1()
+    {
+        uint64_t now = nowTicks();
+        uint64_t bitTicks = uartRegs[1].clkdiv ? uartRegs[1].clkdiv : 1;
+        uint8_t symbolBits = 1 + 5 + ((uartRegs[1].conf0 >> UCBN) & 3) + (((uartRegs[1].conf0 >> UCBS) & 3) == 3 ? 2 : 1);
+        for (;;)
+        {
+            if (uart1WantsRefill())
+            {
+                inUartHandler = true;
+                uartHandler(uartHandlerArg);
+                inUartHandler = false;
+            }
+            if (uart1Fifo.empty() || uart1LineFree + symbolBits * bitTicks > now)
+            {
+                break;
+            }
+            sendSymbol(uart1Fifo.front(), bitTicks);
+            uart1Fifo.pop_front();
+            uart1LineFree += symbolBits * bitTicks;
+        }
+        if (uart1Fifo.empty() && uart1LineFree < now)
+        {
+            chain.level(!uart1Inverted(), now - uart1LineFree); // idle is the stop level, a 1
+            uart1LineFree = now;
+        }
+    }
+
+    void UartFifo::operator=(uint32_t symbol) const
+    {
+        if (u != UART1)
+        {
+            return;
+        }
+        InShim shim;
+        if (!inUartHandler)
+        {
+            runUart1();
+        }
+        if (uart1Fifo.size() < uartFifoSize)
+        {
+            uart1Fifo.push_back(symbol);
+        }
+    }
+
+    UartStatus::operator uint32_t() const
+    {
+        return u == UART1 ? (uint32_t)uart1Fifo.size() << USTXC : 0;
+    }
+
+    UartIntStatus::operator uint32_t() const
+    {
+        uint32_t threshold = (uartRegs[1].conf1 >> UCFET) & 0x7F;
+        return u == UART1 && uart1Fifo.size() <= threshold ? uartRegs[1].intEnable & (1UL << UIFE) : 0;
+    }
+
+    void attachUartInterrupt(ets_isr_t handler, void *arg)
+    {
+        uartHandler = handler;
+        uartHandlerArg = arg;
+    }
+
+    void enableUartInterrupt(bool on) { uartInterrupts = on; }
+
+    void finishOutput()
+    {
+        for (int us = 0; us < 1000000 && (!uart1Fifo.empty() || chain.bits || !chain.bytes.empty() ||
+                                          (uartRegs[1].intEnable & (1UL << UIFE)));
+             us += 10)
+        {
+            advanceMicros(10);
+        }
+    }
+}
+
+// ---- Network ----
+
+namespace hostsim
+{
+    static std::vector<Server *> servers;
+    static uint64_t networkDelay = 20000; // one way, micros
+    static std::vector<std::shared_ptr<Socket>> sockets; // open at the server
+
+    struct InFlight
+    {
+        uint64_t arrives;
+        bool toServer;
+        uint16_t fromPort;
+        uint16_t toPort;
+        std::string bytes;
+        uint8_t fromHost;
+    };
+    static std::deque<InFlight> datagrams; // in arrival order, as the delay is fixed
+    static std::vector<std::weak_ptr<UdpPort>> udpPorts;
+    static double datagramLoss = 0;
+    static uint32_t lossState = 2463534242u; // xorshift32, so runs repeat
+
+    void addServer(Server *s) { servers.push_back(s); }
+
+    static Server *serverFor(uint16_t port)
+    {
+        for (Server *s : servers)
+        {
+            if (s->serves(port))
+            {
+                return s;
+            }
+        }
+        return nullptr;
+    }
+    void setNetworkDelay(unsigned long oneWayMicros) { networkDelay = oneWayMicros; }
+    void setDatagramLoss(double share) { datagramLoss = share; }
+
+    static void launchDatagram(bool toServer, uint16_t fromPort, uint16_t toPort, const std::string &bytes,
+                               uint8_t fromHost = serverHost)
+    {
+        counters.datagramsSent++;
+        lossState ^= lossState << 13;
+        lossState ^= lossState >> 17;
+        lossState ^= lossState << 5;
+        if (lossState < datagramLoss * 4294967296.0)
+        {
+            counters.datagramsLost++;
+            return;
+        }
+        datagrams.push_back({clockMicros + networkDelay, toServer, fromPort, toPort, bytes, fromHost});
+    }
+
+    void sendDatagram(uint16_t toPort, uint16_t fromPort, const std::string &bytes, uint8_t fromHost)
+    {
+        launchDatagram(false, fromPort, toPort, bytes, fromHost);
+    }
+
+    static void deliverDatagrams()
+    {
+        while (!datagrams.empty() && datagrams.front().arrives <= clockMicros)
+        {
+            InFlight d = std::move(datagrams.front());
+            datagrams.pop_front();
+            if (d.toServer)
+            {
+                if (Server *server = serverFor(d.toPort))
+                {
+                    server->datagram(d.fromPort, d.toPort, d.bytes);
+                }
+                continue;
+            }
+            for (auto &weak : udpPorts)
+            {
+                std::shared_ptr<UdpPort> port = weak.lock();
+                if (port && port->port == d.toPort)
+                {
+                    port->arrived.push_back({d.fromPort, d.fromHost, std::move(d.bytes)});
+                    break;
+                }
+            }
+        }
+    }
+
+    void Socket::send(const std::string &bytes)
+    {
+        if (serverClosedAt == UINT64_MAX)
+        {
+            toClient.push_back({clockMicros + networkDelay, bytes});
+        }
+    }
+
+    void Socket::close()
+    {
+        if (serverClosedAt == UINT64_MAX)
+        {
+            serverClosedAt = clockMicros + networkDelay;
+        }
+    }
+
+    // Delivers what has arrived at either end by now, then lets the server
+    // answer anything it holds
+    static void runNetwork()
+    {
+        for (auto &s : sockets)
+        {
+            while (!s->toServer.empty() && s->toServer.front().arrives <= clockMicros)
+            {
+                std::string bytes = std::move(s->toServer.front().bytes);
+                s->toServer.pop_front();
+                s->server->received(*s, bytes);
+            }
+            if (s->clientClosed && s->toServer.empty())
+            {
+                s->server->closed(*s);
+            }
+        }
+        deliverDatagrams();
+        for (Server *server : servers)
+        {
+            server->tick();
+        }
+        for (auto &s : sockets)
+        {
+            while (!s->toClient.empty() && s->toClient.front().arrives <= clockMicros)
+            {
+                s->received += s->toClient.front().bytes;
+                s->toClient.pop_front();
+            }
+        }
+        runAsyncClients();
+        sockets.erase(std::remove_if(sockets.begin(), sockets.end(),
+                                     [](const std::shared_ptr<Socket> &s)
+                                     {
+                                         return (s->clientClosed && s->toServer.empty()) ||
+                                                (s->serverClosedAt <= clockMicros && s->toClient.empty());
+                                     }),
+                      sockets.end());
+    }
+}
+
+int WiFiClient::connect(const IPAddress &, uint16_t port)
+{
+    hostsim::InShim shim;
+    stop();
+    socket_ = std::make_shared<hostsim::Socket>();
+    hostsim::counters.connects++;
+    socket_->server = hostsim::serverFor(port);
+    if (!socket_->server)
+    {
+        socket_->received = hostsim::clientResponse;
+        socket_->serverClosedAt = 0;
+        return 1;
+    }
+    // The core waits out the handshake, running the network meanwhile
+    uint64_t handshake = 2 * hostsim::networkDelay + socket_->server->acceptMs() * 1000ULL;
+    if (!socket_->server->reachable() || handshake > timeout_ * 1000ULL)
+    {
+        socket_.reset();
+        hostsim::advanceMillis(timeout_);
+        return 0;
+    }
+    if (!socket_->server->accept(*socket_))
+    {
+        socket_.reset();
+        hostsim::advanceMicros(2 * hostsim::networkDelay);
+        return 0;
+    }
+    hostsim::sockets.push_back(socket_);
+    hostsim::advanceMicros(handshake);
+    return 1;
+}
+
+int WiFiClient::connect(const char *, uint16_t port)
+{
+    return connect(IPAddress(), port);
+}
+
+// Open until the peer's close has arrived and everything before it is read
+uint8_t WiFiClient::connected()
+{
+    if (!socket_ || socket_->clientClosed)
+    {
+        return 0;
+    }
+    return available() > 0 || socket_->serverClosedAt > hostsim::clockMicros || !socket_->toClient.empty();
+}
+
+int WiFiClient::available()
+{
+    return socket_ ? (int)(socket_->received.size() - socket_->readPos) : 0;
+}
+
+int WiFiClient::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+    size_t n = std::min(size, (size_t)available());
+    if (n == 0)
+    {
+        return socket_ ? 0 : -1;
+    }
+    memcpy(buf, socket_->received.data() + socket_->readPos, n);
+    socket_->readPos += n;
+    if (socket_->readPos == socket_->received.size())
+    {
+        socket_->received.clear();
+        socket_->readPos = 0;
+    }
+    hostsim::counters.bytesReceived += n;
+    return (int)n;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+    hostsim::InShim shim;
+    if (!connected())
+    {
+        return 0;
+    }
+    socket_->toServer.push_back({hostsim::clockMicros + hostsim::networkDelay, std::string((const char *)buf, size)});
+    hostsim::counters.bytesSent += size;
+    return size;
+}
+
+void WiFiClient::stop()
+{
+    hostsim::InShim shim;
+    if (socket_)
+    {
+        socket_->clientClosed = true;
+        socket_.reset();
+    }
+}
+
+namespace hostsim
+{
+    // Function-local, as sketches construct their clients before main()
+    static std::vector<AsyncClient *> &asyncClients()
+    {
+        static std::vector<AsyncClient *> clients;
+        return clients;
+    }
+
+    void runAsyncClients()
+    {
+        // A callback may connect or close a client, never create or destroy one
+        for (AsyncClient *client : asyncClients())
+        {
+            client->run();
+        }
+    }
+}
+
+// lwIP's error codes, as the callbacks get them
+static constexpr int8_t errAbort = -13;
+static constexpr int8_t errReset = -14;
+
+AsyncClient::AsyncClient()
+{
+    hostsim::asyncClients().push_back(this);
+}
+
+AsyncClient::~AsyncClient()
+{
+    auto &clients = hostsim::asyncClients();
+    clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+    if (socket_)
+    {
+        socket_->clientClosed = true;
+    }
+}
+
+IPAddress AsyncClient::remoteIP() const
+{
+    return connected() ? IPAddress(10, 0, 0, hostsim::serverHost) : IPAddress();
+}
+
+bool AsyncClient::connect(const IPAddress &, uint16_t port)
+{
+    hostsim::InShim shim;
+    if (state_ != Disconnected)
+    {
+        return false;
+    }
+    socket_ = std::make_shared<hostsim::Socket>();
+    hostsim::counters.connects++;
+    state_ = Connecting;
+    refused_ = false;
+    socket_->server = hostsim::serverFor(port);
+    if (!socket_->server)
+    {
+        socket_->received = hostsim::clientResponse;
+        socket_->serverClosedAt = 0;
+        connectsAt_ = hostsim::clockMicros;
+        return true;
+    }
+    if (!socket_->server->reachable())
+    {
+        connectsAt_ = UINT64_MAX;
+        return true;
+    }
+    connectsAt_ = hostsim::clockMicros + 2 * hostsim::networkDelay + socket_->server->acceptMs() * 1000ULL;
+    refused_ = !socket_->server->accept(*socket_);
+    if (!refused_)
+    {
+        hostsim::sockets.push_back(socket_);
+    }
+    return true;
+}
+
+// The name resolves at once; the device looks it up without blocking too
+bool AsyncClient::connect(const char *, uint16_t port)
+{
+    return connect(IPAddress(), port);
+}
+
+void AsyncClient::close(bool)
+{
+    if (state_ == Disconnected)
+    {
+        return;
+    }
+    state_ = Disconnected;
+    socket_->clientClosed = true;
+    socket_.reset();
+    if (disconnectCb_)
+    {
+        disconnectCb_(disconnectArg_, this);
+    }
+}
+
+void AsyncClient::abort()
+{
+    if (state_ != Disconnected)
+    {
+        drop(errAbort);
+    }
+}
+
+void AsyncClient::drop(int8_t error)
+{
+    state_ = Disconnected;
+    socket_->clientClosed = true;
+    socket_.reset();
+    if (errorCb_)
+    {
+        errorCb_(errorArg_, this, error);
+    }
+    if (disconnectCb_)
+    {
+        disconnectCb_(disconnectArg_, this);
+    }
+}
+
+size_t AsyncClient::write(const char *data, size_t size)
+{
+    hostsim::InShim shim;
+    if (state_ != Connected)
+    {
+        return 0;
+    }
+    size = std::min(size, space());
+    socket_->toServer.push_back({hostsim::clockMicros + hostsim::networkDelay, std::string(data, size)});
+    hostsim::counters.bytesSent += size;
+    return size;
+}
+
+void AsyncClient::onConnect(AcConnectHandler cb, void *arg)
+{
+    connectCb_ = cb;
+    connectArg_ = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler cb, void *arg)
+{
+    disconnectCb_ = cb;
+    disconnectArg_ = arg;
+}
+
+void AsyncClient::onData(AcDataHandler cb, void *arg)
+{
+    dataCb_ = cb;
+    dataArg_ = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler cb, void *arg)
+{
+    errorCb_ = cb;
+    errorArg_ = arg;
+}
+
+void AsyncClient::run()
+{
+    if (state_ == Connecting)
+    {
+        if (hostsim::clockMicros < connectsAt_)
+        {
+            return;
+        }
+        if (refused_)
+        {
+            drop(errReset);
+            return;
+        }
+        state_ = Connected;
+        if (connectCb_)
+        {
+            connectCb_(connectArg_, this);
+        }
+    }
+    if (state_ != Connected)
+    {
+        return;
+    }
+    if (!socket_->received.empty())
+    {
+        std::string bytes;
+        bytes.swap(socket_->received);
+        hostsim::counters.bytesReceived += bytes.size();
+        if (dataCb_)
+        {
+            dataCb_(dataArg_, this, &bytes[0], bytes.size());
+        }
+    }
+    if (state_ == Connected && socket_->serverClosedAt <= hostsim::clockMicros && socket_->toClient.empty())
+    {
+        close();
+    }
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    hostsim::InShim shim;
+    stop();
+    port_ = std::make_shared<hostsim::UdpPort>();
+    port_->port = port;
+    hostsim::udpPorts.push_back(port_);
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    hostsim::InShim shim;
+    if (port_)
+    {
+        hostsim::udpPorts.erase(std::remove_if(hostsim::udpPorts.begin(), hostsim::udpPorts.end(),
+                                               [&](const std::weak_ptr<hostsim::UdpPort> &p)
+                                               { return p.expired() || p.lock() == port_; }),
+                                hostsim::udpPorts.end());
+        port_.reset();
+    }
+}
+
+int WiFiUDP::parsePacket()
+{
+    hostsim::InShim shim;
+    if (!port_ || port_->arrived.empty())
+    {
+        return 0;
+    }
+    port_->packet = std::move(port_->arrived.front());
+    port_->arrived.pop_front();
+    port_->readPos = 0;
+    return (int)port_->packet.bytes.size();
+}
+
+int WiFiUDP::available()
+{
+    return port_ ? (int)(port_->packet.bytes.size() - port_->readPos) : 0;
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t size)
+{
+    size_t n = std::min(size, (size_t)available());
+    if (n)
+    {
+        memcpy(buf, port_->packet.bytes.data() + port_->readPos, n);
+        port_->readPos += n;
+    }
+    return (int)n;
+}
+
+IPAddress WiFiUDP::remoteIP()
+{
+    return IPAddress(10, 0, 0, port_ ? port_->packet.fromHost : 0);
+}
+
+uint16_t WiFiUDP::remotePort()
+{
+    return port_ ? port_->packet.fromPort : 0;
+}
+
+int WiFiUDP::beginPacket(const IPAddress &, uint16_t port)
+{
+    hostsim::InShim shim;
+    if (!port_)
+    {
+        return 0;
+    }
+    port_->sendTo = port;
+    port_->sending.clear();
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t size)
+{
+    hostsim::InShim shim;
+    if (!port_)
+    {
+        return 0;
+    }
+    port_->sending.append((const char *)buf, size);
+    return size;
+}
+
+int WiFiUDP::endPacket()
+{
+    hostsim::InShim shim;
+    if (!port_)
+    {
+        return 0;
+    }
+    hostsim::launchDatagram(true, port_->port, port_->sendTo, port_->sending);
+    port_->sending.clear();
+    return 1;
+}
+
+bool HTTPClient::begin(WiFiClient &, const String &)
+{
+    return true;
+}
+
+int HTTPClient::GET()
+{
+    hostsim::counters.httpRequests++;
+    body_ = String(hostsim::httpPayload);
+    return hostsim::httpCode;
+}
+
+String HTTPClient::errorToString(int error)
+{
+    switch (error)
+    {
+    case HTTPC_ERROR_CONNECTION_FAILED:
+        return String("connection failed");
+    case HTTPC_ERROR_READ_TIMEOUT:
+        return String("read Timeout");
+    default:
+        return String();
+    }
+}
+
+// ---- EEPROM ----
+
+void EEPROMClass::begin(size_t size)
+{
+    size_ = std::min(size, sizeof(data_));
+}
+
+uint8_t EEPROMClass::read(int address) const
+{
+    return (address >= 0 && (size_t)address < size_) ? data_[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if (address >= 0 && (size_t)address < size_)
+    {
+        data_[address] = value;
+    }
+}
+
+// ---- ArduinoJson ----
+
+DeserializationError deserializeJson(DynamicJsonDocument &doc, const String &json)
+{
+    // Flat {"key": value, ...} objects only
+    const char *p = json.c_str();
+    doc.fields_.clear();
+    p = strchr(p, '{');
+    if (!p)
+    {
+        return DeserializationError::InvalidInput;
+    }
+    p++;
+    while (*p)
+    {
+        const char *k = strchr(p, '"');
+        if (!k)
+        {
+            break;
+        }
+        const char *kEnd = strchr(k + 1, '"');
+        const char *colon = kEnd ? strchr(kEnd, ':') : nullptr;
+        if (!colon)
+        {
+            return DeserializationError::InvalidInput;
+        }
+        const char *v = colon + 1;
+        while (*v == ' ')
+        {
+            v++;
+        }
+        const char *vEnd = v;
+        if (*v == '"')
+        {
+            v++;
+            vEnd = strchr(v, '"');
+            if (!vEnd)
+            {
+                return DeserializationError::InvalidInput;
+            }
+        }
+        else
+        {
+            while (*vEnd && *vEnd != ',' && *vEnd != '}')
+            {
+                vEnd++;
+            }
+        }
+        doc.fields_[std::string(k + 1, kEnd)] = std::string(v, vEnd);
+        p = (*vEnd == '"') ? vEnd + 1 : vEnd;
+        if (*p == '}')
+        {
+            break;
+        }
+    }
+    return DeserializationError::Ok;
+}
@@ -0,0 +1,58 @@
+// The state stream stand-in; see stateserver.h.
+#include <Arduino.h>
+#include <algorithm>
+#include <string>
+#include "stateserver.h"
+
+void StateServer::setOpen(bool o)
+{
+    open = o;
+    if (!open)
+    {
+        for (Stream &s : streams)
+        {
+            s.socket->close();
+        }
+        streams.clear();
+    }
+}
+
+bool StateServer::accept(hostsim::Socket &socket)
+{
+    if (!open)
+    {
+        return false;
+    }
+    streams.push_back({&socket, 0, millis(), millis()});
+    return true;
+}
+
+void StateServer::closed(hostsim::Socket &socket)
+{
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [&](const Stream &s) { return s.socket == &socket; }),
+                  streams.end());
+}
+
+void StateServer::tick()
+{
+    unsigned long now = millis();
+    for (Stream &s : streams)
+    {
+        if (now < s.nextBatch)
+        {
+            continue;
+        }
+        s.nextBatch += batchMs;
+        uint32_t due = (uint64_t)(now - s.start) * statesPerSecond / 1000;
+        uint16_t count = std::min<uint32_t>(due - s.sent, 0xFFFF);
+        std::string batch = {'B', (char)count, (char)(count >> 8)};
+        batch.append((count + 7) / 8, '\0');
+        for (uint16_t i = 0; i < count; i++)
+        {
+            batch[3 + i / 8] |= state(s.sent + i) << (i % 8);
+        }
+        s.sent += count;
+        s.socket->send(batch);
+    }
+}
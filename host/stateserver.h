@@ -0,0 +1,37 @@
+#pragma once
+// Stand-in for the state server random_led_pattern streams from (see
+// led_statestream.h): sends each connection statesPerSecond states as a
+// batch every batchMs, state n being state(n) counted from that
+// connection's start. With open cleared it refuses connections and closes
+// the ones it has, so the sketch polls the JSON server instead.
+#include <vector>
+#include "hostsim.h"
+
+class StateServer : public hostsim::Server
+{
+public:
+    uint16_t port = 6012; // random_led_pattern's streamPort
+    uint32_t statesPerSecond = 5000;
+    unsigned long batchMs = 5;
+
+    void setOpen(bool open);
+
+    static uint8_t state(uint32_t n) { return (n * 2654435761u) >> 31; }
+
+    bool serves(uint16_t p) const override { return p == port; }
+    bool accept(hostsim::Socket &socket) override;
+    void closed(hostsim::Socket &socket) override;
+    void tick() override;
+
+private:
+    struct Stream
+    {
+        hostsim::Socket *socket;
+        uint32_t sent;          // states so far
+        unsigned long start;    // millis
+        unsigned long nextBatch;
+    };
+
+    bool open = true;
+    std::vector<Stream> streams;
+};
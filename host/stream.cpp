@@ -0,0 +1,167 @@
+// Stream runner: plays a renderer streaming DDP frames to led_sketch over the
+// simulated network while a pattern mode runs, and reports how fast frames
+// reached the strip, what the sketch counted as dropped, whether each frame
+// it showed is the one the sender sent, and whether the strip went back to
+// the pattern mode, the one the server changed to meanwhile, once the
+// stream stopped. Before the stream it sends the port noise that should not
+// take the strip over.
+//
+//   stream_led_sketch [seconds] [fps] [loss=percent] [pixels=per packet]
+#include <Arduino.h>
+#include <stdio.h>
+#include <string>
+#include "bench.h"
+#include "hostsim.h"
+#include "led_strip.h"
+#include "led_stream.h"
+#include "modeserver.h"
+#include "streamsender.h"
+
+extern DirtyStrip strip;
+extern ModeServer modeServer;
+extern StreamReceiver stream;
+extern uint8_t currentMode;
+extern const uint8_t modeStream;
+uint8_t findMode(const char *name);
+void applyMode(uint8_t mode);
+void setup();
+void loop();
+
+static StreamSender sender;
+
+// Sends what a DDP port on a LAN also gets besides frames: a discovery
+// query, a status packet, a frame fragment past the end of the strip and
+// bytes that are not DDP at all. None of it should take the strip.
+static void sendNoise(uint16_t leds)
+{
+    uint32_t past = leds * 3;
+    const std::string packets[] = {
+        {0x42, 0, 0, 1, 0, 0, 0, 0, 0, 0},
+        {0x41, 0, 0, (char)246, 0, 0, 0, 0, 0, 2, '{', '}'},
+        {0x41, 1, 0x0B, 1, (char)(past >> 24), (char)(past >> 16), (char)(past >> 8), (char)past, 0, 3, 1, 2, 3},
+        "M-SEARCH * HTTP/1.1\r\n",
+    };
+    for (const std::string &packet : packets)
+    {
+        hostsim::sendDatagram(sender.toPort, 4049, packet);
+    }
+}
+
+// Runs loop() a millisecond at a time until done() or limitMs pass; returns
+// the time taken
+template <typename Done>
+static unsigned long runUntil(Done done, unsigned long limitMs)
+{
+    unsigned long start = millis();
+    while (!done() && millis() - start < limitMs)
+    {
+        hostsim::advanceMillis(1);
+        loop();
+    }
+    return millis() - start;
+}
+
+// True if the frame on the strip is the one the sender sent as frame k,
+// where k is what pixel 0 says
+static bool frameIntact()
+{
+    const Grb *px = strip.frame();
+    uint32_t k = px[0].r | px[0].g << 8 | px[0].b << 16;
+    for (uint16_t i = 0; i < strip.numPixels(); i++)
+    {
+        uint8_t rgb[3];
+        StreamSender::pixel(k, i, rgb);
+        if (px[i] != grb(rgb[0], rgb[1], rgb[2]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long seconds = std::max(argc > 1 ? strtoul(argv[1], nullptr, 10) : 30, 1UL);
+    float fps = argc > 2 ? atof(argv[2]) : 40;
+    double loss = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strncmp(argv[i], "loss=", 5) == 0)
+        {
+            loss = atof(argv[i] + 5) / 100;
+        }
+        else if (strncmp(argv[i], "pixels=", 7) == 0)
+        {
+            sender.pixelsPerPacket = std::max(1, atoi(argv[i] + 7));
+        }
+    }
+
+    benchServers();
+    hostsim::addServer(&sender);
+    setup();
+    sender.leds = strip.numPixels();
+    const char *pattern = "rainbow-flow";
+    const char *changedTo = "soma-haze";
+    modeServer.setMode(pattern);
+    applyMode(findMode(pattern));
+    runUntil([] { return false; }, 2000);
+
+    // Noise for a few seconds, longer than the stream timeout, before the
+    // stream starts
+    uint32_t ignoredBefore = stream.stats().ignored + stream.stats().malformed;
+    for (int i = 0; i < 40; i++)
+    {
+        sendNoise(sender.leds);
+        runUntil([] { return false; }, 100);
+    }
+    uint32_t noise = stream.stats().ignored + stream.stats().malformed - ignoredBefore;
+    bool kept = currentMode == findMode(pattern);
+    hostsim::setDatagramLoss(loss);
+
+    sender.start(fps);
+    unsigned long takeover = runUntil([] { return currentMode == modeStream; }, 5000);
+    if (currentMode != modeStream)
+    {
+        printf("stream never took over\n");
+        return 1;
+    }
+
+    // Stream for the window, changing the server's mode halfway; check every
+    // frame as it is shown
+    uint32_t framesBefore = stream.stats().frames;
+    uint32_t sentBefore = sender.framesSent();
+    uint32_t shown = 0;
+    uint32_t intact = 0;
+    for (unsigned long t = 0; t < seconds * 1000; t++)
+    {
+        if (t == seconds * 500)
+        {
+            modeServer.setMode(changedTo);
+        }
+        uint32_t frames = stream.stats().frames;
+        hostsim::advanceMillis(1);
+        loop();
+        if (stream.stats().frames != frames)
+        {
+            shown++;
+            intact += frameIntact();
+        }
+    }
+    uint32_t sent = sender.framesSent() - sentBefore;
+    sender.stop();
+    hostsim::setDatagramLoss(0);
+    unsigned long fallback = runUntil([] { return currentMode != modeStream; }, 10000);
+
+    const StreamReceiver::Stats &s = stream.stats();
+    printf("%s stream: %lu s at %.0f fps, %u px in %u-px packets, %.0f%% of datagrams lost\n", benchSketch,
+           seconds, fps, sender.leds, sender.pixelsPerPacket, loss * 100);
+    printf("took over in %lu ms; %.1f fps shown of %.1f sent; %u dropped, %u packets lost, %u malformed\n",
+           takeover, (s.frames - framesBefore) / (float)seconds, sent / (float)seconds, s.dropped, s.lostPackets,
+           s.malformed);
+    printf("%u noise packets before the stream: %s\n", noise, kept ? "strip kept its mode" : "strip taken over");
+    printf("%u of %u shown frames exactly as sent\n", intact, shown);
+    bool back = currentMode == findMode(changedTo);
+    printf("stream stopped: back to %s after %lu ms%s\n", back ? changedTo : "the wrong mode", fallback,
+           back ? "" : " (expected the server's latest mode)");
+    return back && kept && intact == shown ? 0 : 1;
+}
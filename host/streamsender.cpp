@@ -0,0 +1,60 @@
+// The DDP stand-in; see streamsender.h.
+#include <Arduino.h>
+#include <string>
+#include "streamsender.h"
+
+static constexpr uint16_t fromPort = 4049;
+
+void StreamSender::start(float fps)
+{
+    running = true;
+    intervalMicros = (uint64_t)(1000000 / fps);
+    nextFrame = hostsim::nowMicros();
+}
+
+void StreamSender::pixel(uint32_t k, uint16_t i, uint8_t rgb[3])
+{
+    if (i == 0)
+    {
+        rgb[0] = k;
+        rgb[1] = k >> 8;
+        rgb[2] = k >> 16;
+        return;
+    }
+    rgb[0] = i * 7 + k * 3;
+    rgb[1] = i * 3 + k * 5;
+    rgb[2] = i + k;
+}
+
+void StreamSender::send()
+{
+    for (uint16_t first = 0; first < leds; first += pixelsPerPacket)
+    {
+        uint16_t count = std::min<uint16_t>(pixelsPerPacket, leds - first);
+        bool push = first + count >= leds;
+        uint32_t offset = first * 3;
+        uint16_t length = count * 3;
+        seq = seq % 15 + 1;
+        std::string packet = {(char)(0x40 | push), (char)seq, 0x0B, 1,
+                              (char)(offset >> 24), (char)(offset >> 16), (char)(offset >> 8), (char)offset,
+                              (char)(length >> 8), (char)length};
+        for (uint16_t i = first; i < first + count; i++)
+        {
+            uint8_t rgb[3];
+            pixel(frames, i, rgb);
+            packet.append((const char *)rgb, 3);
+        }
+        hostsim::sendDatagram(toPort, fromPort, packet);
+        packets++;
+    }
+    frames++;
+}
+
+void StreamSender::tick()
+{
+    while (running && nextFrame <= hostsim::nowMicros())
+    {
+        send();
+        nextFrame += intervalMicros;
+    }
+}
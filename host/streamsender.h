@@ -0,0 +1,37 @@
+#pragma once
+// Stand-in for a renderer streaming DDP frames to the sketch (see
+// led_stream.h): while started, sends a frame every 1/fps seconds as
+// fragments of pixelsPerPacket, the last one with push set. Frame k colors
+// pixel i as pixel(k, i), which carries k in pixel 0 so a receiver's frame
+// can be checked against the one it claims to be.
+#include <vector>
+#include "hostsim.h"
+
+class StreamSender : public hostsim::Server
+{
+public:
+    uint16_t toPort = 4048;
+    uint16_t leds = 300;
+    uint16_t pixelsPerPacket = 120;
+
+    void start(float fps);
+    void stop() { running = false; }
+
+    static void pixel(uint32_t k, uint16_t i, uint8_t rgb[3]);
+
+    uint32_t framesSent() const { return frames; }
+    uint32_t packetsSent() const { return packets; }
+
+    bool serves(uint16_t) const override { return false; }
+    void tick() override;
+
+private:
+    void send();
+
+    bool running = false;
+    uint64_t intervalMicros = 0;
+    uint64_t nextFrame = 0;
+    uint32_t frames = 0;
+    uint32_t packets = 0;
+    uint8_t seq = 0;
+};
@@ -0,0 +1,84 @@
+// Accuracy sweep for led_trig.h: sin16() and cos16() against the exact Q15
+// sine, and the blend helpers against the float blends the modes used to
+// compute, at the 8-bit channel values they produce. Phases are sampled
+// across the whole turn and on both sides of every table entry, where
+// interpolation is weakest. Fails if any is off by more than 1 LSB.
+//
+//   trig_check [stride]
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "led_trig.h"
+
+static const double turn = 2 * M_PI / 4294967296.0;
+
+struct Worst
+{
+    int error = 0;
+    uint32_t phase = 0;
+    uint64_t checked = 0;
+
+    void take(int e, uint32_t p)
+    {
+        checked++;
+        if (abs(e) > abs(error))
+        {
+            error = e;
+            phase = p;
+        }
+    }
+};
+
+static Worst sinError;
+static Worst blendError;
+
+static void check(uint32_t phase)
+{
+    double s = sin(phase * turn);
+    double c = cos(phase * turn);
+    sinError.take(sin16(phase) - (int)lround(32767 * s), phase);
+    sinError.take(cos16(phase) - (int)lround(32767 * c), phase);
+
+    // What (uint8_t)(v * blend) gave with blend = (sin + 1) / 2 in float
+    float sinBlend = ((float)s + 1.0f) / 2.0f;
+    float cosBlend = ((float)c + 1.0f) / 2.0f;
+    uint16_t sinBlendQ = sinBlend16(phase);
+    uint16_t cosBlendQ = cosBlend16(phase);
+    for (int v = 0; v < 256; v++)
+    {
+        blendError.take((int)scaleBlend16(v, sinBlendQ) - (uint8_t)(v * sinBlend), phase);
+        blendError.take((int)scaleBlend16(v, cosBlendQ) - (uint8_t)(v * cosBlend), phase);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t stride = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4099;
+    if (stride == 0)
+    {
+        stride = 1;
+    }
+    for (uint64_t p = 0; p < (1ULL << 32); p += stride)
+    {
+        check((uint32_t)p);
+    }
+    constexpr uint32_t entry = 1UL << (32 - sinTableBits);
+    for (uint64_t p = 0; p < (1ULL << 32); p += entry)
+    {
+        for (uint32_t d : {1u, 2u, entry / 2})
+        {
+            check((uint32_t)(p + d));
+            check((uint32_t)(p - d));
+        }
+    }
+
+    printf("trig: %u-entry table, phases every %u plus both sides of each entry\n", 1u << sinTableBits, stride);
+    printf("sin16/cos16: %llu values, worst %+d LSB of Q15 at phase 0x%08x\n",
+           (unsigned long long)sinError.checked, sinError.error, sinError.phase);
+    printf("blends: %llu channel values, worst %+d LSB of 8 bits at phase 0x%08x\n",
+           (unsigned long long)blendError.checked, blendError.error, blendError.phase);
+    bool ok = abs(sinError.error) <= 1 && abs(blendError.error) <= 1;
+    printf("%s\n", ok ? "within 1 LSB" : "OUT OF BOUNDS: more than 1 LSB off");
+    return ok ? 0 : 1;
+}
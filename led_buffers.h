@@ -0,0 +1,81 @@
+#pragma once
+// Per-LED state buffers, sized from the strip's length at runtime. A pattern
+// declares them as pointers initialized with ledBuffer<T>(n), next to its
+// other default members, so constructing it still starts it over with every
+// buffer zeroed. While a region is open (openLedBuffers()), buffers are
+// carved out of it in order: led_sketch opens the arena slot a mode is being
+// built in, so switching modes never touches the heap. Outside a region they
+// come from the heap and are never freed, for sketches that keep their
+// patterns for the whole run.
+//
+// A pattern that takes buffers declares how many bytes per LED they add up
+// to as ledBytes; ledBufferSpace() turns that into the room to reserve.
+#include <Arduino.h>
+#include <type_traits>
+
+namespace ledbuffers
+{
+    inline uint8_t *next = nullptr;
+    inline uint8_t *end = nullptr;
+}
+
+// Every buffer is rounded up to whole words, so each one starts word aligned
+constexpr size_t ledBufferBytes(size_t bytes)
+{
+    return (bytes + 3) & ~(size_t)3;
+}
+
+// Room for buffers totalling ledBytes per LED on an n-LED strip. A buffer of
+// k-byte elements rounds up to at most k * ledBufferBytes(n), so this covers
+// the rounding of every buffer.
+constexpr size_t ledBufferSpace(uint8_t ledBytes, uint16_t n)
+{
+    return ledBytes * ledBufferBytes(n);
+}
+
+// region must be word aligned
+inline void openLedBuffers(uint8_t *region, size_t size)
+{
+    ledbuffers::next = region;
+    ledbuffers::end = region + size;
+}
+
+inline void closeLedBuffers()
+{
+    ledbuffers::next = ledbuffers::end = nullptr;
+}
+
+// count zeroed elements
+template <typename T>
+T *ledBuffer(uint16_t count)
+{
+    size_t bytes = ledBufferBytes(count * sizeof(T));
+    if (!ledbuffers::next)
+    {
+        T *buf = (T *)calloc(1, bytes);
+        if (!buf)
+        {
+            panic(); // the strip is too long for this sketch's patterns
+        }
+        return buf;
+    }
+    if (bytes > (size_t)(ledbuffers::end - ledbuffers::next))
+    {
+        panic(); // the pattern's ledBytes undercounts its buffers
+    }
+    T *buf = (T *)ledbuffers::next;
+    memset(buf, 0, bytes);
+    ledbuffers::next += bytes;
+    return buf;
+}
+
+// State::ledBytes, or 0 for states without per-LED buffers
+template <typename State, typename = void>
+struct LedBytes : std::integral_constant<uint8_t, 0>
+{
+};
+
+template <typename State>
+struct LedBytes<State, std::void_t<decltype(State::ledBytes)>> : std::integral_constant<uint8_t, State::ledBytes>
+{
+};
@@ -0,0 +1,86 @@
+#pragma once
+// Integer color conversion for the pattern loops. colorHSV() matches
+// Adafruit_NeoPixel::ColorHSV() bit for bit, but inlines into the caller and
+// picks channels from a per-sector table instead of a six-way branch chain.
+#include <Arduino.h>
+#include "led_strip.h"
+
+// Per 255-step sector of the 1530-step wheel, what each of r, g, b holds:
+// 0 = off, 1 = full, 2 = rising with the sector, 3 = falling. Packed r<<4 | g<<2 | b.
+static const uint8_t hueSectors[7] = {
+    (1 << 4) | (2 << 2) | 0, // red -> yellow
+    (3 << 4) | (1 << 2) | 0, // yellow -> green
+    (0 << 4) | (1 << 2) | 2, // green -> cyan
+    (0 << 4) | (3 << 2) | 1, // cyan -> blue
+    (2 << 4) | (0 << 2) | 1, // blue -> magenta
+    (1 << 4) | (0 << 2) | 3, // magenta -> red
+    (1 << 4) | (0 << 2) | 0, // hue 1530 wraps back to red
+};
+
+// Fully saturated, full value r, g, b for a 16-bit hue
+inline void hueWheel(uint16_t hue, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    uint16_t h = (hue * 1530UL + 32768) >> 16;   // 0..1530
+    uint8_t sector = ((uint32_t)(h + 1) * 257) >> 16; // h / 255 without a divide
+    uint8_t rise = h - sector * 255;
+    const uint8_t levels[4] = {0, 255, rise, (uint8_t)(255 - rise)};
+    uint8_t sel = hueSectors[sector];
+    r = levels[sel >> 4];
+    g = levels[(sel >> 2) & 3];
+    b = levels[sel & 3];
+}
+
+// Adafruit's saturation/value step: 1+x scales allow >>8 instead of /255
+inline uint8_t satVal(uint8_t c, uint16_t s1, uint8_t s2, uint16_t v1)
+{
+    return ((((c * s1) >> 8) + s2) * v1) >> 8;
+}
+
+inline uint32_t colorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255)
+{
+    uint8_t r, g, b;
+    hueWheel(hue, r, g, b);
+    uint16_t s1 = 1 + sat;
+    uint8_t s2 = 255 - sat;
+    uint16_t v1 = 1 + val;
+    return ((uint32_t)satVal(r, s1, s2, v1) << 16) | ((uint32_t)satVal(g, s1, s2, v1) << 8) | satVal(b, s1, s2, v1);
+}
+
+// HSL on the same wheel; sat and lum are 0-255 (lum 128 gives the pure hue)
+inline uint32_t colorHSL(uint16_t hue, uint8_t sat, uint8_t lum)
+{
+    uint8_t r, g, b;
+    hueWheel(hue, r, g, b);
+    uint16_t chroma = ((255 - abs(2 * lum - 255)) * (sat + 1)) >> 8;
+    uint8_t m = lum - chroma / 2;
+    return ((uint32_t)(m + ((r * (chroma + 1)) >> 8)) << 16) |
+           ((uint32_t)(m + ((g * (chroma + 1)) >> 8)) << 8) |
+           (m + ((b * (chroma + 1)) >> 8));
+}
+
+// Writes a hue ramp to count pixels from first: pixel k gets hue + k * hueStep
+// (wrapping like uint16_t), converted in one pass straight into strip.frame().
+// The range must lie within the strip.
+template <typename Strip>
+void fillGradient(Strip &strip, uint16_t first, uint16_t count, uint16_t hue, uint16_t hueStep,
+                  uint8_t sat = 255, uint8_t val = 255)
+{
+    uint16_t s1 = 1 + sat;
+    uint8_t s2 = 255 - sat;
+    uint16_t v1 = 1 + val;
+    bool pure = (sat == 255 && val == 255);
+    Grb *px = strip.frame();
+    for (uint16_t i = first; i < first + count; i++)
+    {
+        uint8_t r, g, b;
+        hueWheel(hue, r, g, b);
+        if (!pure)
+        {
+            r = satVal(r, s1, s2, v1);
+            g = satVal(g, s1, s2, v1);
+            b = satVal(b, s1, s2, v1);
+        }
+        px[i] = grb(r, g, b);
+        hue += hueStep;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+// Timing for a crossfade between two modes. The outgoing mode keeps stepping
+// on its own schedule and with its own random stream, so the incoming mode
+// plays out exactly as it would after a cut; the strip mixes the two frames
+// by alpha() in its output pass (DirtyStrip::crossfade()). A frame is shown
+// whenever either mode steps, and at least every frameMs, so the ramp stays
+// smooth even between the steps of a slow mode.
+//
+// The ramp runs from the first blended frame that reached the strip, and a
+// frame counts as shown only once show() sent it, so a strip that is still
+// busy sending delays the fade rather than skipping part of it.
+#include <Arduino.h>
+#include "led_random.h"
+#include "led_scheduler.h"
+
+class Crossfade
+{
+public:
+    static constexpr uint16_t frameMs = 20;
+
+    StepScheduler outgoing; // the outgoing mode's cadence, carried over
+    FastRandom outgoingRng; // and its random stream
+    uint8_t outgoingMode = 0;
+
+    void begin(unsigned long now, uint16_t windowMs)
+    {
+        startedAt = lastFrame = now;
+        window = windowMs;
+        ramp = windowMs ? (256UL << 16) / windowMs : 0;
+        running = true;
+        started = false;
+    }
+
+    void end() { running = false; }
+
+    bool active() const { return running; }
+
+    // Weight of the incoming frame, 0..256; 256 once the window has passed.
+    // 0 until a blended frame has been shown.
+    uint16_t alpha(unsigned long now) const
+    {
+        if (!started)
+        {
+            return 0;
+        }
+        unsigned long elapsed = now - startedAt;
+        return elapsed >= window ? 256 : (elapsed * ramp) >> 16;
+    }
+
+    bool frameDue(unsigned long now) const { return now - lastFrame >= frameMs; }
+
+    // Call when show() sent a blended frame; the first one starts the ramp
+    void shown(unsigned long now)
+    {
+        if (!started)
+        {
+            startedAt = now;
+            started = true;
+        }
+        lastFrame = now;
+    }
+
+private:
+    unsigned long startedAt = 0;
+    unsigned long lastFrame = 0;
+    uint32_t ramp = 0; // alpha per ms, Q16
+    uint16_t window = 0;
+    bool running = false;
+    bool started = false; // a blended frame has gone out
+};
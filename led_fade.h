@@ -0,0 +1,65 @@
+#pragma once
+// Fades for byte intensity buffers, a machine word at a time: four bytes per
+// step on the ESP8266, eight on a 64-bit host. Lanes never carry or borrow
+// into each other, so every byte ends up exactly as the per-byte loop would
+// leave it. Unaligned heads and tails go a byte at a time, since the ESP8266
+// faults on unaligned word access.
+#include <Arduino.h>
+
+typedef uintptr_t FadeWord __attribute__((may_alias));
+
+// v in every byte lane
+constexpr uintptr_t fadeLanes(uint8_t v)
+{
+    return (uintptr_t)-1 / 0xFF * v;
+}
+
+// Runs word() over the aligned middle of buf and byte() over the rest
+template <typename Word, typename Byte>
+void fadeEach(uint8_t *buf, uint16_t n, Word word, Byte byte)
+{
+    uint8_t *p = buf;
+    uint8_t *end = buf + n;
+    while (p < end && (uintptr_t)p % sizeof(FadeWord))
+    {
+        byte(*p++);
+    }
+    for (; end - p >= (ptrdiff_t)sizeof(FadeWord); p += sizeof(FadeWord))
+    {
+        FadeWord &w = *(FadeWord *)p;
+        w = word(w);
+    }
+    while (p < end)
+    {
+        byte(*p++);
+    }
+}
+
+// Every byte loses k, stopping at 0: max(0, x - k)
+inline void fadeBy(uint8_t *buf, uint16_t n, uint8_t k)
+{
+    constexpr uintptr_t high = fadeLanes(0x80);
+    uintptr_t ks = fadeLanes(k);
+    fadeEach(buf, n,
+             [=](uintptr_t w)
+             {
+                 // Lane-wise w - k with the top bits kept out of the borrow
+                 // chain, then the lanes that went below zero cleared
+                 uintptr_t diff = ((w | high) - (ks & ~high)) ^ ((w ^ ~ks) & high);
+                 uintptr_t borrow = ((~w & ks) | (~(w ^ ks) & diff)) & high;
+                 return diff & ~((borrow >> 7) * 0xFF);
+             },
+             [=](uint8_t &x) { x = x > k ? x - k : 0; });
+}
+
+// Every byte scaled by keep / 256: x * keep >> 8
+inline void scaleBy(uint8_t *buf, uint16_t n, uint8_t keep)
+{
+    constexpr uintptr_t even = (uintptr_t)-1 / 0xFFFF * 0xFF; // low byte of each 16-bit lane
+    fadeEach(buf, n,
+             [=](uintptr_t w)
+             {
+                 return (((w & even) * keep >> 8) & even) | (((w >> 8) & even) * keep & ~even);
+             },
+             [=](uint8_t &x) { x = x * keep >> 8; });
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Gamma curve for the output stage in led_strip.h. LEDs are linear in duty
+// cycle but eyes are not, so patterns are written in perceptual levels and
+// converted here. The result keeps 8 fractional bits, which the strip carries
+// through brightness scaling and dithers out over successive frames instead of
+// rounding away.
+#include <Arduino.h>
+
+// round(65280 * (i / 255)^2.2), i = 0..255: 8.8 fixed point, 255.0 at the top
+static const uint16_t gammaTable[256] PROGMEM = {
+    0, 0, 2, 4, 7, 11, 17, 24,
+    32, 42, 53, 65, 78, 94, 110, 128,
+    148, 169, 191, 216, 241, 269, 298, 328,
+    360, 394, 430, 467, 506, 547, 589, 633,
+    679, 726, 776, 827, 880, 934, 991, 1049,
+    1109, 1171, 1235, 1300, 1368, 1437, 1508, 1581,
+    1656, 1733, 1812, 1893, 1975, 2060, 2146, 2235,
+    2325, 2417, 2512, 2608, 2706, 2806, 2908, 3013,
+    3119, 3227, 3337, 3450, 3564, 3680, 3798, 3919,
+    4041, 4166, 4292, 4421, 4552, 4685, 4819, 4956,
+    5096, 5237, 5380, 5525, 5673, 5823, 5974, 6128,
+    6284, 6442, 6603, 6765, 6930, 7097, 7266, 7437,
+    7610, 7786, 7963, 8143, 8325, 8509, 8696, 8885,
+    9075, 9268, 9464, 9661, 9861, 10063, 10267, 10474,
+    10682, 10893, 11107, 11322, 11540, 11760, 11982, 12207,
+    12433, 12663, 12894, 13128, 13363, 13602, 13842, 14085,
+    14330, 14578, 14827, 15080, 15334, 15591, 15850, 16111,
+    16375, 16641, 16909, 17180, 17453, 17729, 18006, 18287,
+    18569, 18854, 19141, 19431, 19723, 20017, 20314, 20613,
+    20915, 21218, 21525, 21833, 22144, 22458, 22774, 23092,
+    23413, 23736, 24062, 24390, 24720, 25053, 25388, 25726,
+    26066, 26408, 26753, 27101, 27451, 27803, 28158, 28515,
+    28875, 29237, 29602, 29969, 30338, 30710, 31085, 31462,
+    31841, 32223, 32608, 32995, 33384, 33776, 34170, 34567,
+    34967, 35369, 35773, 36180, 36589, 37001, 37416, 37833,
+    38252, 38674, 39099, 39526, 39956, 40388, 40823, 41260,
+    41700, 42142, 42587, 43034, 43484, 43937, 44392, 44849,
+    45310, 45772, 46238, 46706, 47176, 47649, 48125, 48603,
+    49084, 49567, 50053, 50542, 51033, 51526, 52023, 52522,
+    53023, 53527, 54034, 54543, 55055, 55570, 56087, 56607,
+    57129, 57654, 58182, 58712, 59245, 59780, 60318, 60859,
+    61402, 61948, 62497, 63048, 63602, 64159, 64718, 65280,
+};
+
+inline uint16_t gamma16(uint8_t v)
+{
+    return pgm_read_word(&gammaTable[v]);
+}
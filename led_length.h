@@ -0,0 +1,42 @@
+#pragma once
+// Strip length as a setting kept in EEPROM, so one image drives strips of any
+// length. A sketch loads it in setup() before sizing anything from it, and
+// keeps its own default when nothing valid is stored. The record is a magic
+// byte followed by the length, little-endian.
+//
+// led_sketch stores the length the server pushes over UDP (led_modepush.h)
+// and restarts to use it. To set it, POST {"length": n} to the server's
+// /length route, which pushes it to every strip that fetched /mode lately.
+// Serial cannot carry it: the sketch runs Serial TX only, as UART1 drives the
+// strip and shares the receive interrupt.
+#include <Arduino.h>
+#include <EEPROM.h>
+
+constexpr int stripLengthAddress = 0;
+constexpr uint8_t stripLengthMagic = 0x4C;
+constexpr size_t stripLengthBytes = 3;
+
+// Modes draw fixed-size features (flames, bursts) that need some room, and
+// every per-LED buffer has to fit in RAM next to the strip's own
+constexpr uint16_t minStripLength = 20;
+constexpr uint16_t maxStripLength = 1200;
+
+inline uint16_t loadStripLength(uint16_t fallback)
+{
+    EEPROM.begin(stripLengthBytes);
+    if (EEPROM.read(stripLengthAddress) != stripLengthMagic)
+    {
+        return fallback;
+    }
+    uint16_t n = EEPROM.read(stripLengthAddress + 1) | EEPROM.read(stripLengthAddress + 2) << 8;
+    return n >= minStripLength && n <= maxStripLength ? n : fallback;
+}
+
+inline void saveStripLength(uint16_t n)
+{
+    EEPROM.begin(stripLengthBytes);
+    EEPROM.write(stripLengthAddress, stripLengthMagic);
+    EEPROM.write(stripLengthAddress + 1, n & 0xFF);
+    EEPROM.write(stripLengthAddress + 2, n >> 8);
+    EEPROM.commit();
+}
@@ -0,0 +1,437 @@
+#pragma once
+// led_sketch's mode fetch: one keep-alive connection to the mode server,
+// over which each GET carries the ETag of the mode last seen. The server
+// answers a request for a different mode at once, and otherwise holds it for
+// up to waitSeconds before answering 304 Not Modified, so a change reaches
+// the strip within a round trip while an idle strip makes about two small
+// requests a minute. A server that ignores the ETag and the wait (or closes
+// after every reply) still works: requests then start no more often than
+// every retryMs, which is plain polling.
+//
+// poll() never waits on the server. Each call advances one request through
+// connect, send and read, parsing whatever part of the reply has arrived,
+// and returns. The connection is ESPAsyncTCP's: WiFiClient::connect() would
+// hold loop() for the whole handshake, or the full timeout when the server
+// is down. Its callbacks, which the SDK runs between passes of loop(), only
+// note the connection's state and copy arriving bytes into a fixed inbox.
+#include <Arduino.h>
+#include <ESPAsyncTCP.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+class ModeFetch
+{
+public:
+    static constexpr uint8_t waitSeconds = 25; // how long the server may hold a request
+    static constexpr uint8_t maxModeLength = 64; // longer payloads are cut
+    static constexpr uint16_t inboxBytes = 512;  // a reply is read as it arrives, well within this
+    static constexpr uint8_t maxDoublings = 5;    // failing retries slow to one per 32 retryMs
+
+    // Totals since boot, for the serial log and the host bench
+    struct Stats
+    {
+        uint32_t connects;
+        uint32_t requests;
+        uint32_t changed;     // 200s, each naming a mode
+        uint32_t notModified; // 304s: held requests that timed out, or repeated polls
+        uint32_t bytesSent;
+        uint32_t bytesReceived;
+    };
+
+    ModeFetch(const char *host, uint16_t port, const char *path)
+        : host(host), port(port), path(path)
+    {
+    }
+
+    // timeoutMs bounds connecting and, on top of waitSeconds, each reply;
+    // retryMs is the least time from one request to the next, doubled for
+    // each failure in a row after the first, up to maxDoublings times
+    void begin(uint16_t timeoutMs, uint16_t retryMs)
+    {
+        this->timeoutMs = timeoutMs;
+        this->retryMs = retryMs;
+        client.onConnect([](void *self, AsyncClient *c) { ((ModeFetch *)self)->connected(c); }, this);
+        client.onDisconnect([](void *self, AsyncClient *) { ((ModeFetch *)self)->open = false; }, this);
+        client.onData([](void *self, AsyncClient *, void *data, size_t len)
+                      { ((ModeFetch *)self)->arrived((const uint8_t *)data, len); },
+                      this);
+    }
+
+    // True when a reply has named a mode, which mode() then holds
+    bool poll(unsigned long now)
+    {
+        switch (stage)
+        {
+        case Idle:
+            if (!requested || now - sentAt >= (unsigned long)retryMs * backoff())
+            {
+                start(now);
+            }
+            return false;
+        case Connecting:
+            return connecting(now);
+        case Sending:
+            return send(now);
+        case Reading:
+            return receive(now);
+        }
+        return false;
+    }
+
+    const char *mode() const { return body; }
+
+    // The server's version of mode(): the number its ETag starts with, or 0
+    // when it sent none (a server from before versions)
+    uint32_t version() const
+    {
+        const char *tag = etag;
+        if (strncmp(tag, "W/", 2) == 0)
+        {
+            tag += 2;
+        }
+        if (*tag == '"')
+        {
+            tag++;
+        }
+        return strtoul(tag, nullptr, 10);
+    }
+
+    // Where host resolved to on the last connect; unset until one succeeds
+    const IPAddress &serverIP() const { return server; }
+
+    // Requests in a row that failed; any answer from the server clears it
+    uint8_t failures() const { return failed; }
+
+    const Stats &stats() const { return counts; }
+
+private:
+    enum Stage : uint8_t
+    {
+        Idle,       // until the next request is due
+        Connecting, // the connection is being opened again
+        Sending,    // the request is waiting for room to go out
+        Reading     // the reply is arriving
+    };
+
+    enum Part : uint8_t
+    {
+        StatusLine,
+        Headers,
+        Body
+    };
+
+    // Starts a request, opening the connection first if it has closed
+    void start(unsigned long now)
+    {
+        requested = true;
+        sentAt = now;
+        inboxLength = 0;
+        overflowed = false;
+        if (open)
+        {
+            stage = Sending;
+            return;
+        }
+        counts.connects++;
+        if (!client.connect(host, port))
+        {
+            fail("connect failed");
+            return;
+        }
+        client.setNoDelay(true);
+        stage = Connecting;
+    }
+
+    bool connecting(unsigned long now)
+    {
+        if (open)
+        {
+            stage = Sending;
+            return false;
+        }
+        if (client.disconnected())
+        {
+            stage = Idle;
+            return fail("connect failed");
+        }
+        if (now - sentAt > timeoutMs)
+        {
+            client.abort();
+            stage = Idle;
+            return fail("connect timed out");
+        }
+        return false;
+    }
+
+    // Writes the request once the connection has room for it
+    bool send(unsigned long now)
+    {
+        if (!open)
+        {
+            stage = Idle;
+            return fail("connection closed");
+        }
+        char request[224];
+        int len = snprintf(request, sizeof(request),
+                           "GET %s?wait=%u HTTP/1.1\r\nHost: %s\r\n%s%s%sConnection: keep-alive\r\n\r\n",
+                           path, waitSeconds, host,
+                           etag[0] ? "If-None-Match: " : "", etag, etag[0] ? "\r\n" : "");
+        if (len <= 0 || len >= (int)sizeof(request))
+        {
+            stage = Idle;
+            return fail("request too long");
+        }
+        if (!client.canSend() || client.space() < (size_t)len)
+        {
+            if (now - sentAt > timeoutMs)
+            {
+                client.close(true);
+                stage = Idle;
+                return fail("send timed out");
+            }
+            return false;
+        }
+        if (client.write(request, len) != (size_t)len)
+        {
+            client.close(true);
+            stage = Idle;
+            return fail("send failed");
+        }
+        counts.requests++;
+        counts.bytesSent += len;
+
+        stage = Reading;
+        part = StatusLine;
+        lineLength = 0;
+        status = 0;
+        bodyLeft = -1;
+        bodyLength = 0;
+        body[0] = '\0';
+        keepAlive = true;
+        replyEtag[0] = '\0';
+        return false;
+    }
+
+    // Runs in the SDK's context once the connection opens
+    void connected(AsyncClient *c)
+    {
+        server = c->remoteIP();
+        open = true;
+    }
+
+    // Runs in the SDK's context as bytes arrive; loop() parses them later
+    void arrived(const uint8_t *data, size_t len)
+    {
+        if (len > sizeof(inbox) - inboxLength)
+        {
+            overflowed = true;
+            return;
+        }
+        memcpy(inbox + inboxLength, data, len);
+        inboxLength += len;
+    }
+
+    // Parses what has arrived of the reply
+    bool receive(unsigned long now)
+    {
+        if (overflowed)
+        {
+            client.close(true);
+            stage = Idle;
+            return fail("reply overflowed the inbox");
+        }
+        if (inboxLength > 0)
+        {
+            uint16_t n = inboxLength;
+            inboxLength = 0;
+            counts.bytesReceived += n;
+            for (uint16_t i = 0; i < n; i++)
+            {
+                if (consume(inbox[i]))
+                {
+                    // Anything after the reply is not for a request of ours
+                    return finish();
+                }
+            }
+            return false;
+        }
+        if (!open)
+        {
+            stage = Idle;
+            // A reply without a length runs to the close
+            if (part == Body && bodyLeft < 0)
+            {
+                return finish();
+            }
+            return fail("connection closed");
+        }
+        if (now - sentAt > waitSeconds * 1000UL + timeoutMs)
+        {
+            client.close(true);
+            stage = Idle;
+            return fail("reply timed out");
+        }
+        return false;
+    }
+
+    // Returns true once the reply is complete
+    bool consume(uint8_t c)
+    {
+        if (part == Body)
+        {
+            if (bodyLength < maxModeLength)
+            {
+                body[bodyLength++] = c;
+            }
+            return bodyLeft > 0 && --bodyLeft == 0;
+        }
+        if (c != '\n')
+        {
+            if (c != '\r' && lineLength < sizeof(line) - 1)
+            {
+                line[lineLength++] = c;
+            }
+            return false;
+        }
+        line[lineLength] = '\0';
+        lineLength = 0;
+        if (part == StatusLine)
+        {
+            const char *code = strchr(line, ' ');
+            status = code ? atoi(code + 1) : 0;
+            keepAlive = strncmp(line, "HTTP/1.0", 8) != 0; // unless a header says otherwise
+            part = Headers;
+            return false;
+        }
+        if (line[0] != '\0')
+        {
+            header();
+            return false;
+        }
+        // Blank line: the body follows, unless there is none
+        part = Body;
+        if (status == 304 || status == 204)
+        {
+            bodyLeft = 0;
+        }
+        return bodyLeft == 0;
+    }
+
+    void header()
+    {
+        char *value = strchr(line, ':');
+        if (!value)
+        {
+            return;
+        }
+        *value++ = '\0';
+        while (*value == ' ')
+        {
+            value++;
+        }
+        if (strcasecmp(line, "Content-Length") == 0)
+        {
+            bodyLeft = atol(value);
+        }
+        else if (strcasecmp(line, "ETag") == 0)
+        {
+            strncpy(replyEtag, value, sizeof(replyEtag) - 1);
+            replyEtag[sizeof(replyEtag) - 1] = '\0';
+        }
+        else if (strcasecmp(line, "Connection") == 0)
+        {
+            keepAlive = strcasecmp(value, "close") != 0;
+        }
+    }
+
+    bool finish()
+    {
+        stage = Idle;
+        if (!keepAlive)
+        {
+            client.close(true);
+        }
+        if (status == 304)
+        {
+            counts.notModified++;
+            failed = 0;
+            return false;
+        }
+        if (status != 200)
+        {
+            client.close(true);
+            Serial.printf("HTTP %d\n", status);
+            return fail("unexpected status");
+        }
+        counts.changed++;
+        failed = 0;
+        memcpy(etag, replyEtag, sizeof(etag));
+        // Trim the payload
+        while (bodyLength > 0 && isspace(body[bodyLength - 1]))
+        {
+            bodyLength--;
+        }
+        body[bodyLength] = '\0';
+        char *start = body;
+        while (isspace(*start))
+        {
+            start++;
+        }
+        memmove(body, start, strlen(start) + 1);
+        Serial.print(F("Received mode: "));
+        Serial.println(body);
+        return body[0] != '\0';
+    }
+
+    // Multiple of retryMs to wait before the next request
+    uint8_t backoff() const
+    {
+        uint8_t doublings = failed > 1 ? failed - 1 : 0;
+        return 1 << (doublings < maxDoublings ? doublings : maxDoublings);
+    }
+
+    bool fail(const char *why)
+    {
+        if (failed < 255)
+        {
+            failed++;
+        }
+        Serial.printf("Mode fetch: %s (%u in a row)\n", why, failed);
+        return false;
+    }
+
+    const char *host;
+    uint16_t port;
+    const char *path;
+    uint16_t timeoutMs = 2500;
+    uint16_t retryMs = 2000;
+
+    AsyncClient client;
+    Stage stage = Idle;
+    bool open = false;      // connected, as the callbacks last said
+    IPAddress server;       // the far end of the last connection
+    unsigned long sentAt = 0; // when the request started, connecting included
+    bool requested = false; // a request has been started since boot
+
+    // Bytes the callbacks took since loop() last parsed
+    uint8_t inbox[inboxBytes];
+    uint16_t inboxLength = 0;
+    bool overflowed = false;
+
+    // The reply being read
+    Part part = StatusLine;
+    char line[96];
+    uint8_t lineLength = 0;
+    int status = 0;
+    long bodyLeft = -1; // -1 until a Content-Length says otherwise
+    char body[maxModeLength + 1] = "";
+    uint8_t bodyLength = 0;
+    bool keepAlive = true;
+    char replyEtag[maxModeLength + 8] = "";
+
+    char etag[maxModeLength + 8] = ""; // of the mode last received
+    uint8_t failed = 0;
+    Stats counts = {};
+};
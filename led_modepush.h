@@ -0,0 +1,150 @@
+#pragma once
+// Mode changes pushed to led_sketch over UDP, ahead of the HTTP fetch. The
+// server sends one datagram per change and resends it until acked; the
+// sequence number lets the strip drop the resends and anything older than
+// the change it already has. Every well-formed datagram is acked, those
+// included, so the sender stops resending once any ack gets through.
+//
+// Only the mode server may push. poll() takes the address the mode fetch
+// last reached it at (ModeFetch::serverIP()) and drops, unacked, datagrams
+// from anywhere else, and all of them until the fetch has connected once.
+// The source port says nothing: the server sends each push from a fresh one.
+//
+// Datagrams start with the magic "LM" and a type, then a little-endian
+// sequence number:
+//
+//   mode:   'L' 'M' 1 seq[4] version[4] name...  (name without terminator, up to 64)
+//   ack:    'L' 'M' 2 seq[4] fresh       (fresh = 1 if it was newer)
+//   length: 'L' 'M' 3 seq[4] leds[2]     (strip length to store; see led_length.h)
+//
+// Sequence numbers compare as serial numbers, so they may wrap, and mode and
+// length pushes share them. The first datagram after boot is taken whatever
+// its number. A mode's version is the server's, the number its /mode ETag
+// starts with (ModeFetch::version()); it orders the modes themselves, so the
+// sketch can tell a push older than the mode the fetch already applied.
+// Sequence numbers cannot: a stale push is still a new datagram.
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <string.h>
+
+class ModePush
+{
+public:
+    static constexpr uint8_t maxModeLength = 64;
+    static constexpr uint8_t headerBytes = 7;
+    static constexpr uint8_t versionBytes = 4;
+
+    enum Type : uint8_t
+    {
+        ModeChange = 1,
+        Ack = 2,
+        StripLength = 3
+    };
+
+    struct Stats
+    {
+        uint32_t changes;    // datagrams newer than any before, lengths included
+        uint32_t duplicates; // resends and stale ones, acked and dropped
+        uint32_t malformed;
+        uint32_t strangers;  // not from the server, dropped unacked
+    };
+
+    void begin(uint16_t port)
+    {
+        listenPort = port;
+        udp.begin(port);
+    }
+
+    uint16_t port() const { return listenPort; }
+
+    // True when a datagram from server names a newer mode, which mode() then
+    // holds. A newer strip length is kept for takeStripLength() instead.
+    bool poll(const IPAddress &server)
+    {
+        int size = udp.parsePacket();
+        if (size <= 0)
+        {
+            return false;
+        }
+        // The next parsePacket() drops what is left of it
+        if (server == IPAddress() || udp.remoteIP() != server)
+        {
+            counts.strangers++;
+            return false;
+        }
+        uint8_t packet[headerBytes + versionBytes + maxModeLength];
+        int n = udp.read(packet, sizeof(packet));
+        bool isMode = n >= headerBytes + versionBytes + 1 && packet[2] == ModeChange;
+        bool isLength = n == headerBytes + 2 && packet[2] == StripLength;
+        if (!(isMode || isLength) || size > (int)sizeof(packet) || packet[0] != 'L' || packet[1] != 'M')
+        {
+            counts.malformed++;
+            return false;
+        }
+        uint32_t seq = le32(packet + 3);
+        bool fresh = !synced || (int32_t)(seq - lastSeq) > 0;
+        ack(seq, fresh);
+        if (!fresh)
+        {
+            counts.duplicates++;
+            return false;
+        }
+        synced = true;
+        lastSeq = seq;
+        counts.changes++;
+        if (isLength)
+        {
+            stripLength = packet[headerBytes] | packet[headerBytes + 1] << 8;
+            Serial.printf("Pushed strip length %u (#%u)\n", stripLength, seq);
+            return false;
+        }
+        modeVersion = le32(packet + headerBytes);
+        uint8_t length = n - headerBytes - versionBytes;
+        memcpy(name, packet + headerBytes + versionBytes, length);
+        name[length] = '\0';
+        // The name can be 64 bytes, past what printf() formats on the stack
+        Serial.print(F("Pushed mode "));
+        Serial.print(name);
+        Serial.printf(" v%u (#%u)\n", modeVersion, seq);
+        return true;
+    }
+
+    const char *mode() const { return name; }
+
+    // The server's version of mode()
+    uint32_t version() const { return modeVersion; }
+
+    // The strip length last pushed, once; 0 if none came since the last call
+    uint16_t takeStripLength()
+    {
+        uint16_t n = stripLength;
+        stripLength = 0;
+        return n;
+    }
+
+    const Stats &stats() const { return counts; }
+
+private:
+    static uint32_t le32(const uint8_t *p)
+    {
+        return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    void ack(uint32_t seq, bool fresh)
+    {
+        uint8_t reply[headerBytes + 1] = {'L', 'M', Ack, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16),
+                                          (uint8_t)(seq >> 24), fresh};
+        udp.beginPacket(udp.remoteIP(), udp.remotePort());
+        udp.write(reply, sizeof(reply));
+        udp.endPacket();
+    }
+
+    WiFiUDP udp;
+    uint16_t listenPort = 0;
+    bool synced = false; // a change has been taken since boot
+    uint32_t lastSeq = 0;
+    char name[maxModeLength + 1] = "";
+    uint32_t modeVersion = 0;
+    uint16_t stripLength = 0;
+    Stats counts = {};
+};
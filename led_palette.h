@@ -0,0 +1,45 @@
+#pragma once
+// Intensity-to-color palettes. A mode that keeps a byte of intensity per pixel
+// colors it through a 256-entry table instead of per-pixel multiplies and
+// divides. The tables are computed by the compiler and kept in flash, one
+// packed word per entry, so a lookup is a single aligned flash read. A new
+// color theme for a mode is a new table, not new arithmetic.
+#include <Arduino.h>
+#include "led_strip.h"
+
+struct Palette
+{
+    uint32_t entry[256]; // Grb bytes in wire order, packed little-endian
+
+    Grb operator[](uint8_t i) const
+    {
+        uint32_t c = pgm_read_dword(&entry[i]);
+        return {(uint8_t)c, (uint8_t)(c >> 8), (uint8_t)(c >> 16)};
+    }
+};
+
+// Tabulates shade(i) for every intensity; use it in a constexpr PROGMEM
+// definition so the work is done at compile time
+template <typename Shade>
+constexpr Palette makePalette(Shade shade)
+{
+    Palette p{};
+    for (int i = 0; i < 256; i++)
+    {
+        Grb c = shade((uint8_t)i);
+        p.entry[i] = c.g | (uint32_t)c.r << 8 | (uint32_t)c.b << 16;
+    }
+    return p;
+}
+
+// Colors n pixels from their intensities in one pass
+inline void colorize(Grb *px, const uint8_t *intensity, uint16_t n, const Palette &palette)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        px[i] = palette[intensity[i]];
+    }
+}
+
+// Shared by several modes
+inline constexpr Palette redPalette PROGMEM = makePalette([](uint8_t i) { return grb(i, 0, 0); });
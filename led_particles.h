@@ -0,0 +1,146 @@
+#pragma once
+// Moving heads with gradient trails, for the ball and comet modes. Particle
+// state is kept as parallel arrays (all positions, then all velocities), so a
+// step walks flat arrays however many particles a mode runs. A mode's look is
+// a Trail: the head and its fading trail, shaded once when the mode starts.
+// Drawing a particle copies (or lightens) that gradient onto the strip in
+// one clipped pass. The heading is the sign of the velocity, so nothing per
+// pixel or per particle divides.
+#include <Arduino.h>
+
+// Entry 0 colors the head, entry t the pixel t trail steps behind it
+template <typename T, uint8_t Capacity>
+struct Trail
+{
+    T shade[Capacity];
+    uint8_t length = 0;
+
+    Trail() = default;
+
+    // behind(t) shades entry t for t = 1 .. length - 1
+    template <typename Shade>
+    Trail(T head, Shade behind, uint8_t len = Capacity) : length(len)
+    {
+        shade[0] = head;
+        for (uint8_t t = 1; t < length; t++)
+        {
+            shade[t] = behind(t);
+        }
+    }
+};
+
+// How a trail pixel lands on what is already there
+struct Overwrite
+{
+    template <typename T>
+    void operator()(T &dst, T src) const { dst = src; }
+};
+
+struct Lighten
+{
+    void operator()(uint8_t &dst, uint8_t src) const { dst = max(dst, src); }
+};
+
+// Draws trail with its head at pixel head and entry t at head - t * step,
+// into an n-pixel buffer. Entries off either end are skipped.
+template <typename T, uint8_t C, typename Blend = Overwrite>
+void drawTrail(T *dst, uint16_t n, int16_t head, int8_t step, const Trail<T, C> &trail,
+               Blend blend = Blend())
+{
+    const T *s = trail.shade;
+    const T *end = s + trail.length;
+    int16_t p = head;
+    while (s < end && (uint16_t)p >= n) // not on the strip yet
+    {
+        s++;
+        p -= step;
+    }
+    for (; s < end && (uint16_t)p < n; s++, p -= step)
+    {
+        blend(dst[p], *s);
+    }
+}
+
+// The same on a ring: entries past either end come back in at the other.
+// |step| * length must not exceed n.
+template <typename T, uint8_t C, typename Blend = Overwrite>
+void drawTrailRing(T *dst, uint16_t n, int16_t head, int8_t step, const Trail<T, C> &trail,
+                   Blend blend = Blend())
+{
+    int16_t p = head;
+    for (uint8_t t = 0; t < trail.length; t++, p -= step)
+    {
+        if (p < 0)
+        {
+            p += n;
+        }
+        else if (p >= (int16_t)n)
+        {
+            p -= n;
+        }
+        blend(dst[p], trail.shade[t]);
+    }
+}
+
+// Max particles moving along a strip. Pos is the position type; velocities
+// are whole pixels per step.
+template <uint16_t Max, typename Pos = int16_t>
+struct Particles
+{
+    Pos pos[Max];
+    int8_t vel[Max];
+
+    // Max particles evenly spaced along an n-pixel strip from pixel 0
+    static Particles spread(uint16_t n, const int8_t (&velocities)[Max])
+    {
+        Particles p;
+        for (uint16_t i = 0; i < Max; i++)
+        {
+            p.pos[i] = (uint32_t)i * n / Max;
+            p.vel[i] = velocities[i];
+        }
+        return p;
+    }
+
+    int8_t heading(uint16_t i) const { return vel[i] < 0 ? -1 : 1; }
+
+    bool onStrip(uint16_t i, uint16_t n) const { return pos[i] >= 0 && pos[i] < n; }
+
+    // Steps every particle in turn: draw(i), then move it, and where it
+    // reaches either end of the n-pixel strip turn it around and call
+    // onBounce(at) with where it landed
+    template <typename Draw, typename OnBounce>
+    void bounce(uint16_t n, Draw draw, OnBounce onBounce)
+    {
+        for (uint16_t i = 0; i < Max; i++)
+        {
+            draw(i);
+            pos[i] += vel[i];
+            if (pos[i] <= 0 || pos[i] >= n - 1)
+            {
+                vel[i] = -vel[i];
+                onBounce(pos[i]);
+            }
+        }
+    }
+
+    template <typename Draw>
+    void bounce(uint16_t n, Draw draw)
+    {
+        bounce(n, draw, [](int16_t) {});
+    }
+
+    // Moves particle i around an n-pixel ring; |vel| must be below n
+    void wrap(uint16_t i, uint16_t n)
+    {
+        pos[i] += vel[i];
+        if (pos[i] < 0)
+        {
+            pos[i] += n;
+        }
+        else if (pos[i] >= n)
+        {
+            pos[i] -= n;
+        }
+    }
+};
@@ -0,0 +1,468 @@
+#pragma once
+// Patterns shared by led_sketch, car_leds and sydney_leds. Each one is a state
+// struct built for a strip length, with a step() templated on the strip type,
+// so only the patterns a sketch instantiates end up in its image. A sketch
+// keeps one instance per mode and lets the StepScheduler (led_scheduler.h)
+// call step(strip, dtMs), which advances one frame and returns the delay in
+// ms until the next one. The default member values are the pattern's starting
+// state, so constructing an instance starts it over.
+//
+// The length is a constructor argument, since it is a runtime setting (see
+// led_length.h), and starting positions are spread along it. Per-LED buffers
+// come from ledBuffer() and are counted in ledBytes (see led_buffers.h).
+//
+// step() writes the strip's frame() directly (see led_strip.h), so indices
+// must be in range before they are written.
+#include <Arduino.h>
+#include "led_strip.h"
+#include "led_trig.h"
+#include "led_color.h"
+#include "led_random.h"
+#include "led_particles.h"
+#include "led_ripple.h"
+#include "led_fade.h"
+#include "led_palette.h"
+#include "led_buffers.h"
+
+// Rainbow gradient with white/gold/pink sparkles. The main install sparkles
+// twice as often and lifts the red-to-green third of the wheel.
+template <uint8_t SparkleChance = 5, bool BrightWarmHues = false>
+struct RainbowFlow
+{
+    static constexpr uint8_t ledBytes = 4;
+
+    uint16_t n;
+    uint16_t hue = 0;
+    uint8_t *sparkles = ledBuffer<uint8_t>(n);
+    uint8_t (*sparkleColors)[3] = ledBuffer<uint8_t[3]>(n);
+
+    explicit RainbowFlow(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        constexpr uint32_t rate = trigRate(0.01);
+        uint32_t phase = hue * rate; // sin((hue + i * 100) * 0.01)
+        Grb *px = strip.frame();
+        fadeBy(sparkles, n, 20);
+        // Full rainbow cycle: pixel i is i * 65536 / n round the wheel,
+        // stepped with the remainder carried instead of divided per pixel
+        uint16_t wheelStep = 65536L / n;
+        uint16_t wheelCarry = 65536L % n;
+        uint16_t offset = 0;
+        uint16_t carried = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (sparkles[i] > 0)
+            {
+                px[i] = grb(sparkleColors[i][0], sparkleColors[i][1], sparkleColors[i][2]);
+            }
+            else
+            {
+                uint16_t h = hue + offset;
+                uint16_t wave = sinBlend16(phase);
+                uint8_t v = (BrightWarmHues && h < 21845) ? 150 + scaleBlend16(50, wave) : 100 + scaleBlend16(100, wave);
+                px[i] = grb(colorHSV(h, 255, v));
+            }
+            phase += 100 * rate;
+            offset += wheelStep;
+            carried += wheelCarry;
+            if (carried >= n)
+            {
+                offset++;
+                carried -= n;
+            }
+        }
+        if (rng.percent(SparkleChance))
+        {
+            for (int j = 0; j < rng.range(1, 4); j++)
+            {
+                int spark = rng.below(n);
+                sparkles[spark] = rng.range(180, 255);
+                uint8_t sparkType = rng.below(3);
+                if (sparkType == 0)
+                { // White
+                    sparkleColors[spark][0] = sparkles[spark];
+                    sparkleColors[spark][1] = sparkles[spark];
+                    sparkleColors[spark][2] = sparkles[spark];
+                }
+                else if (sparkType == 1)
+                { // Gold
+                    sparkleColors[spark][0] = sparkles[spark];
+                    sparkleColors[spark][1] = sparkles[spark] * 200 / 255;
+                    sparkleColors[spark][2] = sparkles[spark] * 50 / 255;
+                }
+                else
+                { // Neon pink
+                    sparkleColors[spark][0] = sparkles[spark];
+                    sparkleColors[spark][1] = sparkles[spark] * 105 / 255;
+                    sparkleColors[spark][2] = sparkles[spark] * 180 / 255;
+                }
+            }
+        }
+        hue += 512;
+        return rng.range(15, 30);
+    }
+};
+
+inline constexpr Palette emberPalette PROGMEM = makePalette([](uint8_t i) { return grb(i, i / 10, 0); });
+
+// Red-orange embers that flare at random and die away
+template <const Palette &Colors = emberPalette>
+struct ProletariatCrackle
+{
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n;
+    uint8_t *intensities = ledBuffer<uint8_t>(n);
+
+    explicit ProletariatCrackle(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        // Every ember draws its own fade, so no word-wide fadeBy() here. One
+        // that fades past 0 wraps round and flares up again, as it always has.
+        for (uint16_t i = 0; i < n; i++)
+        {
+            intensities[i] -= rng.range(5, 15);
+        }
+        colorize(strip.frame(), intensities, n, Colors);
+        for (int i = 0; i < 8; i++)
+        {
+            int led = rng.below(n);
+            intensities[led] = rng.range(50, 255);
+        }
+        return rng.range(30, 100);
+    }
+};
+
+// Pink comets falling through a dark blue sky. A comet's fade depends on its
+// length, so there is one trail per length.
+struct LoonieFreefall
+{
+    static constexpr uint8_t minLength = 5;
+    static constexpr uint8_t maxLength = 14;
+
+    uint16_t n;
+    Particles<10> comets = {}; // position 0 is a free slot
+    uint8_t lengths[10] = {0};
+    Trail<Grb, maxLength> trails[maxLength - minLength + 1];
+
+    explicit LoonieFreefall(uint16_t n) : n(n)
+    {
+        for (uint8_t len = minLength; len <= maxLength; len++)
+        {
+            uint8_t fade = 255 / len;
+            auto shade = [fade](uint8_t t)
+            {
+                uint8_t intensity = 255 - t * fade;
+                return grb(intensity, intensity / 2, intensity);
+            };
+            trails[len - minLength] = Trail<Grb, maxLength>(grb(255, 127, 255), shade, len);
+        }
+    }
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        Grb *px = strip.frame();
+        strip.fill(grb(0, 0, 20)); // Galactic background
+        for (int c = 0; c < 10; c++)
+        {
+            if (comets.pos[c] == 0 && rng.percent(8))
+            {
+                comets.pos[c] = 1;                     // Start new comet
+                lengths[c] = rng.range(minLength, maxLength + 1); // Length
+                comets.vel[c] = rng.range(2, 5);       // Speed
+            }
+            if (comets.pos[c] > 0)
+            {
+                // Brightest at the back, trailing off ahead of it
+                drawTrail(px, n, comets.pos[c], -1, trails[lengths[c] - minLength]);
+                comets.pos[c] += comets.vel[c];
+                if (comets.pos[c] + lengths[c] >= n)
+                {
+                    comets.pos[c] = 0;
+                }
+            }
+        }
+        return 25;
+    }
+};
+
+// Bouncing balls with dotted trails, each channel flickering on and off at random
+struct BistromathicsSurge
+{
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n;
+    Particles<5> balls = Particles<5>::spread(n, {3, -3, 3, -3, 3});
+    Trail<uint8_t, 6> trail{255, [](uint8_t t) { return (uint8_t)(255 - t * 40); }};
+    uint8_t *intensities = ledBuffer<uint8_t>(n);
+
+    explicit BistromathicsSurge(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        memset(intensities, 0, n);
+        // Bouncing ball trails for mathematical chaos
+        balls.bounce(n, [this](uint16_t b)
+                     { drawTrail(intensities, n, balls.pos[b], balls.heading(b) * 2, trail, Lighten()); });
+        Grb *px = strip.frame();
+        for (int i = 0; i < n; i++)
+        {
+            uint8_t flips = rng.bits(3); // Chaotic colors: one coin per channel
+            uint8_t r = intensities[i] * (flips & 1);
+            uint8_t g = intensities[i] * ((flips >> 1) & 1);
+            uint8_t b = intensities[i] * (flips >> 2);
+            px[i] = grb(r, g, b);
+        }
+        return 25;
+    }
+};
+
+// Green slings over a deep green base, rippling where they hit the ends
+struct GroksDissolution
+{
+    uint16_t n;
+    Particles<4> slings = Particles<4>::spread(n, {5, -4, 6, -5});
+    Trail<Grb, 15> trail{grb(50, 255, 50), [](uint8_t t) { return grb(20, 200 - t * 13, 20); }};
+
+    explicit GroksDissolution(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        Grb *px = strip.frame();
+        strip.fill(grb(0, 20, 0)); // Deep green base
+        auto draw = [&](uint16_t s)
+        {
+            if (slings.onStrip(s, n))
+            {
+                drawTrail(px, n, slings.pos[s], slings.heading(s), trail);
+            }
+        };
+        auto ripple = [&](int16_t at)
+        {
+            int rippleStart = max(0, at - 29);
+            int rippleEnd = min((int)n, at + 30);
+            if (rippleStart < rippleEnd)
+            {
+                strip.fill(grb(100, 255, 100), rippleStart, rippleEnd - rippleStart);
+            }
+        };
+        slings.bounce(n, draw, ripple);
+        return 30;
+    }
+};
+
+// Drifting rainbow with per-pixel hue jitter and occasional jumps
+struct InfiniteImprobabilityDrive
+{
+    uint16_t n;
+    uint16_t hue = 0;
+
+    explicit InfiniteImprobabilityDrive(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        Grb *px = strip.frame();
+        uint32_t jitter = 65536L / n;
+        for (int i = 0; i < n; i++)
+        {
+            px[i] = grb(colorHSV(hue + rng.below(jitter))); // Random hue shifts for improbability, HHGTTG style
+        }
+        if (rng.percent(10))
+        {
+            hue = rng.bits(16); // Sudden "drive" jumps
+        }
+        else
+        {
+            hue += 500;
+        }
+        return 20;
+    }
+};
+
+inline constexpr Palette vogonPalette PROGMEM =
+    makePalette([](uint8_t i) { return grb(i / 2, i * 3 / 4, i / 3); });
+
+// Yellow-green ripples spreading from wandering centers
+template <const Palette &Colors = vogonPalette>
+struct VogonPoetryPulse
+{
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n;
+    uint8_t *ripples = ledBuffer<uint8_t>(n);
+    int rippleCenters[4] = {0};
+
+    explicit VogonPoetryPulse(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        Grb *px = strip.frame();
+        fadeBy(ripples, n, 8);
+        colorize(px, ripples, n, Colors);
+        for (int rc = 0; rc < 4; rc++)
+        {
+            if (rng.percent(25))
+            {
+                rippleCenters[rc] = rng.below(n);
+            }
+            for (int d = 0; d < 20; d++)
+            {
+                int left = rippleCenters[rc] - d;
+                int right = rippleCenters[rc] + d;
+                uint8_t intensity = 150 - d * 7;
+                if (left >= 0)
+                    ripples[left] = max(ripples[left], intensity);
+                if (right < n)
+                    ripples[right] = max(ripples[right], intensity);
+            }
+        }
+        return 60;
+    }
+};
+
+inline constexpr Palette sheepPalette PROGMEM =
+    makePalette([](uint8_t i) { return grb(0, min(255, i * 3 / 2), i / 4); });
+
+// Expanding green rings that reset at random
+template <const Palette &Colors = sheepPalette>
+struct ElectricSheepDream
+{
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n;
+    uint16_t rippleCenters[5] = {0};
+    uint8_t rippleRadii[5] = {0};
+    Falloff<30> falloff{[](uint8_t d) { return (uint8_t)(255 - d * 10); }};
+    uint8_t *intensities = ledBuffer<uint8_t>(n); // cleared again as each frame is colored
+
+    explicit ElectricSheepDream(uint16_t n) : n(n) {}
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        for (int r = 0; r < 5; r++)
+        {
+            drawRipple(intensities, n, rippleCenters[r], rippleRadii[r], falloff);
+        }
+        Grb *px = strip.frame();
+        for (int i = 0; i < n; i++)
+        {
+            px[i] = Colors[intensities[i]];
+            intensities[i] = 0;
+        }
+        for (int r = 0; r < 5; r++)
+        {
+            rippleRadii[r] = min(30, rippleRadii[r] + 1);
+            if (rippleRadii[r] >= 30 || rng.percent(5))
+            {
+                rippleCenters[r] = rng.below(n);
+                rippleRadii[r] = 0;
+            }
+        }
+        return 50;
+    }
+};
+
+// Neighbouring domains conquering each other until one color holds the strip.
+// Each round, every pixel takes over its left and then its right neighbour
+// with 6% chance each; a neighbour conquered from both sides goes to the one
+// on its right. Rounds are applied in place with a two-pixel carry, and the
+// run (domain) count is kept up to date on every write, so convergence is a
+// comparison rather than a scan. The palette only matters when seeding.
+struct Conquest
+{
+    static constexpr uint8_t ledBytes = 3;
+
+    uint16_t n;
+    Grb *colors = ledBuffer<Grb>(n);
+    uint16_t runs = 1; // maximal spans of one color; 1 means converged
+
+    explicit Conquest(uint16_t n) : n(n) {}
+
+    // Fills the strip from palette() after reseeding rng, so a given
+    // seed and palette always play out the same way
+    void seed(uint32_t s, Grb (*palette)())
+    {
+        rng.seed(s);
+        for (uint16_t i = 0; i < n; i++)
+        {
+            colors[i] = palette();
+        }
+        runs = 1;
+        for (uint16_t i = 1; i < n; i++)
+        {
+            runs += colors[i] != colors[i - 1];
+        }
+    }
+
+    template <typename Strip>
+    uint16_t step(Strip &strip, uint32_t)
+    {
+        if (runs > 1)
+        {
+            advance();
+        }
+        strip.span(0, colors, n);
+        return 15;
+    }
+
+    void advance()
+    {
+        // Pixel i - 1 is settled once pixel i has drawn its left conquest:
+        // it then needs only the old colors of i - 2, i - 1 and i, and
+        // whether i - 2 conquered rightwards
+        Grb older = colors[0]; // old color of pixel i - 2
+        bool rightFrom2 = false;  // pixel i - 2 conquered pixel i - 1
+        bool rightFrom1 = false;  // pixel i - 1 conquers pixel i
+        for (uint16_t i = 0; i < n; i++)
+        {
+            bool left = i > 0 && rng.percent(6);
+            bool right = i < n - 1 && rng.percent(6);
+            if (i > 0)
+            {
+                Grb prev = colors[i - 1];
+                if (left)
+                {
+                    set(i - 1, colors[i]);
+                }
+                else if (rightFrom2)
+                {
+                    set(i - 1, older);
+                }
+                older = prev;
+            }
+            rightFrom2 = rightFrom1;
+            rightFrom1 = right;
+        }
+        if (rightFrom2)
+        {
+            set(n - 1, older);
+        }
+    }
+
+    void set(uint16_t i, Grb c)
+    {
+        if (c == colors[i])
+        {
+            return;
+        }
+        if (i > 0)
+        {
+            runs += (colors[i - 1] != c) - (colors[i - 1] != colors[i]);
+        }
+        if (i < n - 1)
+        {
+            runs += (colors[i + 1] != c) - (colors[i + 1] != colors[i]);
+        }
+        colors[i] = c;
+    }
+};
@@ -0,0 +1,77 @@
+#pragma once
+// Pattern RNG. Arduino random() goes through the SDK generator and a modulo
+// on every call; the pattern loops draw from this xorshift32 instead. Small
+// draws are cut from a 32-bit pool, so random(2) costs one bit, and ranges
+// are reduced by masking and rejecting, which is unbiased and divides
+// nothing. Sketches reseed it whenever a mode starts, so each mode plays out
+// the same way from entry, on the device and on the host alike.
+#include <Arduino.h>
+
+class FastRandom
+{
+public:
+    void seed(uint32_t s)
+    {
+        state = s ? s : 0x9E3779B9; // xorshift never leaves 0
+        poolBits = 0;
+    }
+
+    // Fixed seed per mode index (golden-ratio spaced, never 0)
+    void seedMode(uint8_t mode) { seed(0x9E3779B9UL * (mode + 1)); }
+
+    // 32 fresh bits
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // n random bits, 1 <= n <= 32. A request the pool cannot cover
+    // refills it and drops the leftovers.
+    uint32_t bits(uint8_t n)
+    {
+        if (n > poolBits)
+        {
+            pool = next();
+            poolBits = 32;
+        }
+        uint32_t v = n < 32 ? pool & ((1UL << n) - 1) : pool;
+        pool = n < 32 ? pool >> n : 0;
+        poolBits -= n;
+        return v;
+    }
+
+    bool coin() { return bits(1); }
+
+    // Uniform in [0, n); n = 0 gives 0, like random(0)
+    uint32_t below(uint32_t n)
+    {
+        if (n <= 1)
+        {
+            return 0;
+        }
+        uint8_t width = 32 - __builtin_clz(n - 1); // folds for constant n
+        uint32_t v;
+        do
+        {
+            v = bits(width);
+        } while (v >= n);
+        return v;
+    }
+
+    // Uniform in [lo, hi), the same contract as random(lo, hi)
+    int32_t range(int32_t lo, int32_t hi) { return hi > lo ? lo + (int32_t)below(hi - lo) : lo; }
+
+    // True with the given percent chance
+    bool percent(uint8_t p) { return below(100) < p; }
+
+private:
+    uint32_t state = 0x9E3779B9;
+    uint32_t pool = 0;
+    uint8_t poolBits = 0;
+};
+
+// One generator per sketch; only one mode draws from it at a time
+inline FastRandom rng;
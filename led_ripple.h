@@ -0,0 +1,41 @@
+#pragma once
+// Expanding ripples, drawn as spans. Each ripple lightens an intensity buffer
+// only over [center - radius, center + radius], reading its brightness by
+// distance from a falloff table shaded when the mode starts, so a frame costs
+// the total width of its ripples rather than strip length times ripple count.
+// The mode colors the buffer afterwards and clears it as it goes.
+#include <Arduino.h>
+
+// Brightness by distance from a ripple's center, for distances below Reach
+template <uint8_t Reach>
+struct Falloff
+{
+    uint8_t level[Reach];
+
+    template <typename Shade>
+    explicit Falloff(Shade shade)
+    {
+        for (uint8_t d = 0; d < Reach; d++)
+        {
+            level[d] = shade(d);
+        }
+    }
+};
+
+// Max-blends one ripple into an n-pixel buffer, clipped to it; radius must
+// be below Reach
+template <uint8_t Reach>
+void drawRipple(uint8_t *buf, uint16_t n, int16_t center, uint8_t radius, const Falloff<Reach> &falloff)
+{
+    int16_t first = max(center - radius, 0);
+    int16_t last = min(center + radius, n - 1);
+    int16_t i = first;
+    for (; i <= last && i < center; i++)
+    {
+        buf[i] = max(buf[i], falloff.level[center - i]);
+    }
+    for (; i <= last; i++)
+    {
+        buf[i] = max(buf[i], falloff.level[i - center]);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+// Owns animation time for the active mode. A mode's step function advances
+// one frame and returns how long until it wants the next step; loop() asks
+// due() every pass and only steps, and shows, when that time has come. The
+// mode gets the time since its previous step as a delta, so nothing keeps a
+// millis() gate of its own and steps never alias against a loop() interval.
+#include <Arduino.h>
+#include <algorithm>
+
+class StepScheduler
+{
+public:
+    // Starts a mode: the first step is due immediately
+    void restart(unsigned long now)
+    {
+        startedAt = lastStep = nextStep = now;
+        steps = 0;
+        requestedMs = 0;
+        worstLate = 0;
+    }
+
+    bool due(unsigned long now) const { return (long)(now - nextStep) >= 0; }
+
+    // Delta-time handed to the step that is about to run
+    uint32_t sinceLast(unsigned long now) const { return now - lastStep; }
+
+    void stepped(unsigned long now, uint16_t delayMs)
+    {
+        worstLate = std::max<uint32_t>(worstLate, now - nextStep);
+        // Keep the requested cadence when a step runs a little late, but
+        // after a stall (HTTP poll, reconnect) resume rather than burst
+        nextStep = (now - nextStep < delayMs) ? nextStep + delayMs : now + delayMs;
+        lastStep = now;
+        steps++;
+        requestedMs += delayMs;
+    }
+
+    // Step rate the mode asked for vs. the one it got since restart()
+    float targetFps() const { return requestedMs ? steps * 1000.0f / requestedMs : 0; }
+    float achievedFps(unsigned long now) const
+    {
+        return now != startedAt ? steps * 1000.0f / (now - startedAt) : 0;
+    }
+
+    uint32_t stepCount() const { return steps; }
+
+    // Frame pacing: the furthest behind its due time a step has run since
+    // restart(). Anything past the mode's own interval was a dropped frame.
+    uint32_t worstLateMs() const { return worstLate; }
+
+private:
+    unsigned long startedAt = 0;
+    unsigned long lastStep = 0;
+    unsigned long nextStep = 0;
+    uint32_t steps = 0;
+    uint32_t requestedMs = 0;
+    uint32_t worstLate = 0;
+};
@@ -1,64 +1,134 @@
 #include <ESP8266WiFi.h>
-#include <ESP8266HTTPClient.h>
-#include <WiFiClient.h>
-#include <Adafruit_NeoPixel.h>
 #include <math.h>
 #include <algorithm>
 #include <cstring>
+#include <new>
+#include "led_strip.h"
+#include "led_trig.h"
+#include "led_color.h"
+#include "led_patterns.h"
+#include "led_particles.h"
+#include "led_ripple.h"
+#include "led_fade.h"
+#include "led_palette.h"
+#include "led_scheduler.h"
+#include "led_crossfade.h"
+#include "led_buffers.h"
+#include "led_length.h"
+#include "led_modefetch.h"
+#include "led_modepush.h"
+#include "led_stream.h"
 
 // Wi-Fi credentials
 const char *ssid = "BrubakerWifi2";
 const char *password = "Pre$ton01";
 
-// Flask server URL for mode
-const char *serverUrl = "http://pebbles.immenseaccumulationonline.online:8080/mode";
+// Flask server for mode (led_strips_server.py)
+const char *serverHost = "pebbles.immenseaccumulationonline.online";
+const uint16_t serverPort = 8080;
+const char *modePath = "/mode";
+const uint16_t modePushPort = 4210; // the server pushes mode changes here over UDP (led_modepush.h)
+const uint16_t streamPort = 4048;   // DDP frames from a renderer (led_stream.h)
 
 // LED strip configuration
-#define NUM_LEDS 300
+#define DEFAULT_NUM_LEDS 300 // when EEPROM holds no length (see led_length.h)
 #define DATA_PIN 2 // GPIO2
 #define BRIGHTNESS 50 // 0-255
-Adafruit_NeoPixel strip = Adafruit_NeoPixel(NUM_LEDS, DATA_PIN, NEO_GRB + NEO_KHZ800);
+DirtyStrip strip = DirtyStrip(DEFAULT_NUM_LEDS, DATA_PIN, NEO_GRB + NEO_KHZ800);
+uint16_t storedStripLength = 0; // read from EEPROM in setup(); 0 if none was stored
+Ws2812Uart1 ledUart; // GPIO2 is UART1 TX: frames go out under interrupt, not bit-banged
+const uint16_t crossfadeMs = 1500; // mode changes blend over this long; 0 cuts straight over
+// Frames further apart than this are rounded rather than dithered: a mode
+// that steps rarely only shows when it steps, and dim levels would blink
+const uint16_t ditherMaxMs = 25;
 
 // Timing
-const unsigned long pollInterval = 2000;   // Poll every 2 seconds for mode
-const unsigned long httpTimeoutMs = 2500;  // Keep HTTP short so LEDs stay responsive
+const uint16_t pollInterval = 2000;   // Least spacing between mode requests; the server holds them longer
+const uint16_t httpTimeoutMs = 2500;  // Connect timeout, and grace on top of the server's hold
 const unsigned long wifiConnectTimeoutMs = 15000;
 const unsigned long wifiReconnectIntervalMs = 5000;  // spacing between non-blocking reconnect tries
 const unsigned long wifiOfflineRestartMs = 45000;    // hard reset if offline this long
+const unsigned long streamTimeoutMs = 2500;   // back to the pattern mode after this long without stream packets
+const unsigned long streamLogIntervalMs = 10000;
+const unsigned long heapLogIntervalMs = 600000; // heap health over serial every 10 minutes
 
 // After this many consecutive failures, hard-reset the chip (recovery from hung WiFi/HTTP stacks)
-const uint8_t maxConsecutiveHttpFailures = 8;  // ~16s of bad polls
+const uint8_t maxConsecutiveHttpFailures = 8;  // ~3 min of failed connects as retries back off, or 8 replies that never came
 
-// Current mode and timing
-String currentMode = "off";
-unsigned long lastPoll = 0;
-unsigned long lastUpdate = 0;
-unsigned long updateInterval = 30; // Default ~33 FPS, adjustable per mode
+// Loop timing
 unsigned long lastWifiReconnectAttempt = 0;
 unsigned long wifiOfflineSince = 0; // 0 = currently online
 
-uint8_t consecutiveHttpFailures = 0;
-
-// Conquest mode globals (for random-conquest and red-green-conquest)
-// Buffers live in BSS, never on the tiny ESP-01 stack
-uint32_t randomConquestColors[NUM_LEDS];
-uint32_t randomConquestNewColors[NUM_LEDS];
-bool randomConquestInitialized = false;
-bool randomConquestConverged = false;
-
-uint32_t redGreenConquestColors[NUM_LEDS];
-uint32_t redGreenConquestNewColors[NUM_LEDS];
-bool redGreenConquestInitialized = false;
-bool redGreenConquestConverged = false;
+// Long-polls the server for the mode over one kept-alive connection; pushed
+// changes usually arrive first, and the fetch catches any that were lost
+ModeFetch modeFetch(serverHost, serverPort, modePath);
+ModePush modePush;
+uint32_t modeVersion = 0; // the server's version of the mode last taken; 0 until one came with a version
+
+// Streamed frames take the strip over from the pattern modes while they keep
+// coming; the server's mode changes meanwhile wait in streamFallback
+StreamReceiver stream;
+unsigned long lastStreamLog = 0;
+uint32_t lastStreamFrames = 0;
+
+// Heap health since boot. Nothing in loop() allocates, so free heap and the
+// largest block should hold steady over days of uptime; safeRestart() logs
+// them too, so a wedged stack can be told from a starved heap.
+unsigned long lastHeapLog = 0;
+uint32_t bootFreeHeap = 0;
+uint32_t lowestFreeHeap = UINT32_MAX;
+uint8_t worstFragmentation = 0;
 
 // Forward declarations
 void setLedsOff();
-void setLedsRed();
-void resetModeState();
-String getModeFromServer();
 void safeRestart(const char *reason);
 bool ensureWiFi();
 void feedWatchdog();
+uint8_t findMode(const char *name);
+bool newerMode(uint32_t version);
+void switchTo(const char *name);
+void applyMode(uint8_t mode);
+void allocateModeArena(uint16_t n);
+void outOfRam(const char *reason);
+void setStripLength(uint16_t leds);
+void logModeArena();
+uint8_t *modeSlot(uint8_t slot);
+bool stepCrossfade(unsigned long now);
+void updateStream(unsigned long now);
+void endCrossfade();
+Grb randomConquestColor();
+Grb redGreenConquestColor();
+
+// Mode registry, in the server's VALID_MODES order. The HTTP payload is resolved
+// to an index once per mode change; loop() steps the mode through the scheduler.
+// Each mode's state is a struct that only exists while the mode runs, built in
+// one of two modeArena slots on entry and torn down on exit (see the registry at
+// the bottom). The second slot holds the outgoing mode during a crossfade.
+struct ModeEntry
+{
+    const char *name;
+    uint16_t (*step)(void *state, uint32_t dtMs); // advances one frame, returns ms until the next
+    void (*enter)(void *state);                   // constructs the state in an arena slot
+    void (*exit)(void *state);                    // destroys it and clears the slot
+    uint16_t stateSize;
+    uint8_t stateAlign;
+    uint8_t ledBytes; // per-LED buffers, carved from the slot after the state
+};
+
+extern const ModeEntry modes[];
+extern const uint8_t modeCount;
+constexpr uint8_t modeOff = 0;
+extern const uint8_t modeStream; // last in the registry, and not one of the server's modes
+
+// Current mode (index into modes[]), its arena slot and the clock that steps it
+uint8_t currentMode = modeOff;
+uint8_t streamFallback = modeOff; // the mode a stream took over from
+uint8_t currentSlot = 0;
+StepScheduler scheduler;
+
+// The mode being faded out, which draws into fadeFrame while the strip blends
+Crossfade transition;
+uint8_t *fadeFrame; // sized with the strip in setup()
 
 void feedWatchdog()
 {
@@ -70,13 +140,11 @@ void safeRestart(const char *reason)
 {
     Serial.print(F("Restarting: "));
     Serial.println(reason);
+    logHeap();
     Serial.flush();
     // Brief visual cue that a reset is about to happen
-    for (int i = 0; i < NUM_LEDS; i++)
-    {
-        strip.setPixelColor(i, strip.Color(0, 0, 0));
-    }
-    strip.show();
+    strip.clear();
+    strip.showNow();
     delay(100);
     ESP.restart();
     // If restart returns (should not), hang until hardware WDT fires
@@ -136,15 +204,38 @@ void setup()
     // Software watchdog (~8s): if the main loop wedges without feeding, reset
     ESP.wdtEnable(8000);
 
-    Serial.begin(115200);
+    Serial.begin(115200, SERIAL_8N1, SERIAL_TX_ONLY); // UART1's interrupt is shared with receive
     delay(100);
     Serial.println();
     Serial.println(F("LED strip client boot"));
 
+    storedStripLength = loadStripLength(0);
+    uint16_t leds = storedStripLength ? storedStripLength : DEFAULT_NUM_LEDS;
+    strip.updateLength(leds);
+    if (strip.numPixels() != leds)
+    {
+        outOfRam("No RAM for the strip");
+    }
+    allocateModeArena(strip.numPixels());
+    fadeFrame = (uint8_t *)calloc(strip.numPixels(), 3);
+    if (!fadeFrame)
+    {
+        outOfRam("No RAM for the crossfade frame");
+    }
+    Serial.printf("%u LEDs\n", strip.numPixels());
+    logModeArena();
+
+    strip.useUart(ledUart);
     strip.begin();
     strip.setBrightness(BRIGHTNESS);
+    // Low BRIGHTNESS leaves few wire levels for the dim fades; the strip
+    // still works without, on a length that leaves no RAM for it
+    if (!strip.setGammaDither(true))
+    {
+        Serial.println(F("No RAM for dithering"));
+    }
     setLedsOff();
-    strip.show();
+    strip.showNow();
 
     WiFi.mode(WIFI_STA);
     WiFi.setSleepMode(WIFI_NONE_SLEEP); // more stable long-running polls
@@ -166,8 +257,14 @@ void setup()
     Serial.print(F("Connected, IP: "));
     Serial.println(WiFi.localIP());
 
-    lastPoll = 0; // poll immediately on first loop
-    lastUpdate = 0;
+    modeFetch.begin(httpTimeoutMs, pollInterval); // first request goes out on the first loop
+    modePush.begin(modePushPort);
+    stream.begin(streamPort, strip.numPixels());
+    modes[currentMode].enter(modeSlot(currentSlot));
+    scheduler.restart(millis());
+    bootFreeHeap = ESP.getFreeHeap();
+    logHeap();
+    lastHeapLog = millis();
 }
 
 void loop()
@@ -177,821 +274,473 @@ void loop()
     // Keep WiFi up (non-blocking). Restarts after prolonged offline; LEDs always continue.
     const bool wifiOk = ensureWiFi();
 
-    // Poll server for mode updates (single short attempt; restart after streak of failures)
-    if (wifiOk && (millis() - lastPoll >= pollInterval))
+    // Take pushed changes, and advance the mode fetch (neither waits on the
+    // server; restart after a streak of fetch failures)
+    if (wifiOk && modePush.poll(modeFetch.serverIP()) && newerMode(modePush.version()))
     {
-        lastPoll = millis();
-        String newMode = getModeFromServer();
-        if (newMode.length() > 0 && newMode != currentMode)
-        {
-            currentMode = newMode;
-            Serial.print(F("New mode: "));
-            Serial.println(currentMode);
-            setLedsOff();
-            resetModeState();
-            if (currentMode == "random-conquest" || currentMode == "red-green-conquest")
-            {
-                updateInterval = 15;
-            }
-            else
-            {
-                updateInterval = 30;
-            }
-        }
+        switchTo(modePush.mode());
+    }
+    if (uint16_t leds = modePush.takeStripLength())
+    {
+        setStripLength(leds);
+    }
+    if (wifiOk && modeFetch.poll(millis()) && newerMode(modeFetch.version()))
+    {
+        switchTo(modeFetch.mode());
+    }
+    if (modeFetch.failures() >= maxConsecutiveHttpFailures)
+    {
+        safeRestart("HTTP poll failures exhausted");
     }
 
-    // Update LED pattern based on mode (always — never block animation on network)
-    if (millis() - lastUpdate >= updateInterval)
+    // Step the mode when it is due (always — never block animation on network)
+    unsigned long now = millis();
+    bool render = stepCrossfade(now);
+    // Only a DDP data packet for the strip takes it over (led_stream.h)
+    if (wifiOk && stream.pending())
     {
-        if (currentMode == "rainbow-flow")
-        {
-            rainbowFlow();
-        }
-        else if (currentMode == "constant-red")
-        {
-            setLedsRed();
-        }
-        else if (currentMode == "off")
-        {
-            setLedsOff();
-        }
-        else if (currentMode == "proletariat-crackle")
-        {
-            proletariatCrackle();
-        }
-        else if (currentMode == "soma-haze")
-        {
-            somaHaze();
-        }
-        else if (currentMode == "loonie-freefall")
-        {
-            loonieFreefall();
-        }
-        else if (currentMode == "bokanovsky-burst")
-        {
-            bokanovskyBurst();
-        }
-        else if (currentMode == "total-perspective-vortex")
-        {
-            totalPerspectiveVortex();
-        }
-        else if (currentMode == "golgafrincham-drift")
-        {
-            golgafrinchamDrift();
-        }
-        else if (currentMode == "bistromathics-surge")
-        {
-            bistromathicsSurge();
-        }
-        else if (currentMode == "groks-dissolution")
-        {
-            groksDissolution();
-        }
-        else if (currentMode == "newspeak-shrink")
-        {
-            newspeakShrink();
-        }
-        else if (currentMode == "nolite-te-bastardes")
-        {
-            noliteTeBastardes();
-        }
-        else if (currentMode == "infinite-improbability-drive")
-        {
-            infiniteImprobabilityDrive();
-        }
-        else if (currentMode == "big-brother-glare")
-        {
-            bigBrotherGlare();
-        }
-        else if (currentMode == "replicant-retirement")
-        {
-            replicantRetirement();
-        }
-        else if (currentMode == "water-brother-bond")
-        {
-            waterBrotherBond();
-        }
-        else if (currentMode == "hypnopaedia-hum")
-        {
-            hypnopaediaHum();
-        }
-        else if (currentMode == "vogon-poetry-pulse")
-        {
-            vogonPoetryPulse();
-        }
-        else if (currentMode == "thought-police-flash")
+        if (currentMode != modeStream)
         {
-            thoughtPoliceFlash();
+            applyMode(modeStream);
         }
-        else if (currentMode == "electric-sheep-dream")
-        {
-            electricSheepDream();
-        }
-        else if (currentMode == "random-conquest")
-        {
-            randomConquest();
-        }
-        else if (currentMode == "red-green-conquest")
-        {
-            redGreenConquest();
-        }
-        strip.show();
-        lastUpdate = millis();
-        feedWatchdog();
+        render |= stream.receive(strip, now);
     }
-}
-
-// Single short HTTP GET. On success returns trimmed mode string; on failure "".
-// After maxConsecutiveHttpFailures, restarts the chip so a wedged TCP/DNS stack recovers.
-String getModeFromServer()
-{
-    String mode = "";
-    WiFiClient client;
-    HTTPClient http;
-
-    http.setTimeout(httpTimeoutMs);
-    http.setReuse(false); // avoid stale keep-alive sockets on ESP8266
-
-    Serial.print(F("HTTP GET "));
-    Serial.println(serverUrl);
-
-    bool began = http.begin(client, serverUrl);
-    if (!began)
+    else if (currentMode == modeStream)
     {
-        Serial.println(F("http.begin failed"));
-        http.end();
-        consecutiveHttpFailures++;
+        updateStream(now);
     }
-    else
+    if (now - lastHeapLog >= heapLogIntervalMs)
     {
-        feedWatchdog();
-        int httpCode = http.GET();
-        Serial.print(F("HTTP Code: "));
-        Serial.println(httpCode);
-
-        if (httpCode == HTTP_CODE_OK)
+        logHeap();
+        lastHeapLog = now;
+    }
+    if (scheduler.due(now))
+    {
+        uint16_t nextMs = modes[currentMode].step(modeSlot(currentSlot), scheduler.sinceLast(now));
+        scheduler.stepped(now, nextMs);
+        strip.setDither(nextMs <= ditherMaxMs);
+        render = true;
+    }
+    // A frame the UART was too busy for goes out on a later pass; the
+    // stream's frame only while it holds a whole one
+    if ((render || strip.showPending()) && (currentMode != modeStream || stream.frameReady()))
+    {
+        bool blended = false;
+        if (transition.active())
         {
-            mode = http.getString();
-            mode.trim();
-            // Guard against absurd payloads that would bloat heap
-            if (mode.length() > 64)
+            uint16_t alpha = transition.alpha(now);
+            if (alpha < 256)
             {
-                mode = mode.substring(0, 64);
-                mode.trim();
+                strip.crossfade(fadeFrame, alpha);
+                blended = true;
             }
-            Serial.print(F("Received mode: "));
-            Serial.println(mode);
-            consecutiveHttpFailures = 0;
-        }
-        else
-        {
-            if (httpCode < 0)
+            else
             {
-                Serial.printf("HTTP error: %s\n", http.errorToString(httpCode).c_str());
+                endCrossfade();
             }
-            consecutiveHttpFailures++;
         }
-        http.end();
-    }
-
-    client.stop();
-    feedWatchdog();
-
-    if (mode.length() == 0)
-    {
-        Serial.printf("HTTP failures: %u/%u\n",
-                      consecutiveHttpFailures, maxConsecutiveHttpFailures);
-        if (consecutiveHttpFailures >= maxConsecutiveHttpFailures)
+        // The fade only moves on once its frame is out
+        if (strip.show() && blended)
         {
-            safeRestart("HTTP poll failures exhausted");
+            transition.shown(now);
         }
+        feedWatchdog();
     }
-
-    return mode;
-}
-
-void resetModeState()
-{
-    // Reset conquest mode states so re-entering a conquest mode restarts fresh
-    randomConquestInitialized = false;
-    randomConquestConverged = false;
-    redGreenConquestInitialized = false;
-    redGreenConquestConverged = false;
 }
 
-void setPixel(int pixel, byte red, byte green, byte blue)
+// Logs free heap, the largest free block and how fragmented the rest is,
+// with the worst of each since boot. Each line stays under the 64 bytes
+// Serial.printf() formats on the stack, so logging does not allocate.
+void logHeap()
 {
-    strip.setPixelColor(pixel, strip.Color(red, green, blue));
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxFreeBlockSize();
+    uint8_t fragmentation = ESP.getHeapFragmentation();
+    lowestFreeHeap = std::min(lowestFreeHeap, freeHeap);
+    worstFragmentation = std::max(worstFragmentation, fragmentation);
+    Serial.printf("Heap: %u free, %u lowest, %u at boot\n", freeHeap, lowestFreeHeap, bootFreeHeap);
+    Serial.printf("Heap: %u largest block, %u%% fragmented (%u%% worst)\n", largest, fragmentation,
+                  worstFragmentation);
 }
 
-void setAll(byte red, byte green, byte blue)
+// Logs the stream's frame rate now and then, and hands the strip back to the
+// pattern mode once the stream stops
+void updateStream(unsigned long now)
 {
-    for (int i = 0; i < NUM_LEDS; i++)
+    const StreamReceiver::Stats &s = stream.stats();
+    if (now - lastStreamLog >= streamLogIntervalMs)
     {
-        strip.setPixelColor(i, strip.Color(red, green, blue));
+        // Two calls, so neither passes the 64 bytes printf() formats on the stack
+        Serial.printf("Stream: %.1f fps, %u frames dropped, ",
+                      (s.frames - lastStreamFrames) * 1000.0f / (now - lastStreamLog), s.dropped);
+        Serial.printf("%u packets lost\n", s.lostPackets);
+        lastStreamLog = now;
+        lastStreamFrames = s.frames;
+    }
+    if (stream.idleFor(now) >= streamTimeoutMs)
+    {
+        Serial.println(F("Stream stopped"));
+        applyMode(streamFallback);
     }
 }
 
-void hslToRgb(float h, float s, float l, uint8_t &r, uint8_t &g, uint8_t &b)
+// Steps the outgoing mode of a crossfade into fadeFrame when it is due, on its
+// own clock and random stream. Returns true when the blend needs a new frame.
+bool stepCrossfade(unsigned long now)
 {
-    // h: 0-360, s: 0-1, l: 0-1
-    float c = (1.0f - fabs(2.0f * l - 1.0f)) * s; // Chroma
-    float x = c * (1.0f - fabs(fmod(h / 60.0f, 2.0f) - 1.0f));
-    float m = l - c / 2.0f;
-    float r1, g1, b1;
-    if (h >= 0 && h < 60)
-    {
-        r1 = c;
-        g1 = x;
-        b1 = 0;
-    }
-    else if (h >= 60 && h < 120)
+    if (!transition.active())
     {
-        r1 = x;
-        g1 = c;
-        b1 = 0;
+        return false;
     }
-    else if (h >= 120 && h < 180)
+    bool render = transition.frameDue(now);
+    if (transition.outgoing.due(now))
     {
-        r1 = 0;
-        g1 = c;
-        b1 = x;
+        uint8_t *canvas = strip.drawInto(fadeFrame);
+        std::swap(rng, transition.outgoingRng);
+        uint16_t nextMs = modes[transition.outgoingMode].step(modeSlot(!currentSlot),
+                                                              transition.outgoing.sinceLast(now));
+        std::swap(rng, transition.outgoingRng);
+        strip.drawInto(canvas);
+        transition.outgoing.stepped(now, nextMs);
+        render = true;
     }
-    else if (h >= 180 && h < 240)
-    {
-        r1 = 0;
-        g1 = x;
-        b1 = c;
-    }
-    else if (h >= 240 && h < 300)
-    {
-        r1 = x;
-        g1 = 0;
-        b1 = c;
-    }
-    else
-    {
-        r1 = c;
-        g1 = 0;
-        b1 = x;
-    }
-    r = (uint8_t)((r1 + m) * 255);
-    g = (uint8_t)((g1 + m) * 255);
-    b = (uint8_t)((b1 + m) * 255);
+    return render;
 }
 
-void randomConquest()
+// Tears down the outgoing mode and shows the incoming one unblended
+void endCrossfade()
 {
-    if (!randomConquestInitialized)
-    {
-        // Unique seed using hardware ID + analog noise - never repeats across devices or power cycles in practice
-        randomSeed(ESP.getChipId() ^ (uint32_t)analogRead(A0));
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            uint8_t r = random(0, 60);  // Ensure reasonably bright colors
-            uint8_t g = random(0, 60);
-            uint8_t b = random(0, 60);
-            randomConquestColors[i] = strip.Color(r, g, b);
-        }
-        randomConquestInitialized = true;
-        randomConquestConverged = false;
-    }
+    modes[transition.outgoingMode].exit(modeSlot(!currentSlot));
+    strip.crossfade(nullptr, 0);
+    transition.end();
+}
 
-    if (randomConquestConverged)
+// Resolves a server payload to its registry index. Unknown names map to "off".
+uint8_t findMode(const char *name)
+{
+    for (uint8_t i = 0; i < modeCount; i++)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
+        if (strcmp(modes[i].name, name) == 0)
         {
-            strip.setPixelColor(i, randomConquestColors[i]);
+            return i;
         }
-        return;
     }
+    Serial.print(F("Unknown mode: "));
+    Serial.println(name);
+    return modeOff;
+}
 
-    // Check if all LEDs are the same color (converged)
-    bool allSame = true;
-    uint32_t refColor = randomConquestColors[0];
-    for (int i = 1; i < NUM_LEDS; i++)
-    {
-        if (randomConquestColors[i] != refColor)
-        {
-            allSame = false;
-            break;
-        }
-    }
-    if (allSame)
+// Switches to a mode the server has named, unless it is already running. A
+// stream keeps the strip until it stops, then gives it to that mode.
+// Pushes and fetches race, and a resent push or a reply that was already on
+// its way can carry a mode the server has since replaced. Versions compare as
+// serial numbers; a mode without one (an older server) is always taken.
+bool newerMode(uint32_t version)
+{
+    if (version == 0)
     {
-        randomConquestConverged = true;
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, refColor);
-        }
-        return;
+        return true;
     }
-
-    // Advance one iteration: each LED has a low chance (~6%) to take over each neighbor
-    // Use BSS buffer — stack cannot hold 300 * 4 bytes on ESP-01
-    for (int i = 0; i < NUM_LEDS; i++)
+    if (modeVersion != 0 && (int32_t)(version - modeVersion) < 0)
     {
-        randomConquestNewColors[i] = randomConquestColors[i];
+        Serial.printf("Mode v%u is older than v%u, ignored\n", version, modeVersion);
+        return false;
     }
+    modeVersion = version;
+    return true;
+}
 
-    for (int i = 0; i < NUM_LEDS; i++)
+void switchTo(const char *name)
+{
+    uint8_t mode = findMode(name);
+    if (currentMode == modeStream && mode != modeStream)
     {
-        if (i > 0 && random(100) < 6)  // Low chance to conquer left neighbor
-        {
-            randomConquestNewColors[i - 1] = randomConquestColors[i];
-        }
-        if (i < NUM_LEDS - 1 && random(100) < 6)  // Low chance to conquer right neighbor
-        {
-            randomConquestNewColors[i + 1] = randomConquestColors[i];
-        }
-        if ((i & 31) == 0)
-        {
-            feedWatchdog();
-        }
+        streamFallback = mode;
     }
-
-    // Commit new state
-    for (int i = 0; i < NUM_LEDS; i++)
+    else if (mode != currentMode)
     {
-        randomConquestColors[i] = randomConquestNewColors[i];
-        strip.setPixelColor(i, randomConquestColors[i]);
+        applyMode(mode);
     }
 }
 
-void redGreenConquest()
+void applyMode(uint8_t mode)
 {
-    if (!redGreenConquestInitialized)
-    {
-        // Unique seed (different base for variety)
-        randomSeed(ESP.getChipId() ^ (uint32_t)analogRead(A0) ^ 0xDEADBEEF);
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            if (random(100) < 50)
-            {
-                // First half: random shades of red
-                uint8_t r = 0;
-                uint8_t g = 0;
-                uint8_t b = random(5, 80);
-                redGreenConquestColors[i] = strip.Color(r, g, b);
-            }
-            else
-            {
-                // Second half: random shades of green
-                uint8_t r = 0;
-                uint8_t g = random(5, 80);
-                uint8_t b = 0;
-                redGreenConquestColors[i] = strip.Color(r, g, b);
-            }
-        }
-        redGreenConquestInitialized = true;
-        redGreenConquestConverged = false;
-    }
-
-    if (redGreenConquestConverged)
+    unsigned long now = millis();
+    Serial.print(F("Leaving "));
+    Serial.print(modes[currentMode].name);
+    Serial.printf(": %.1f of %.1f fps, %u ms worst lag\n", scheduler.achievedFps(now), scheduler.targetFps(),
+                  scheduler.worstLateMs());
+    if (mode == modeStream)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, redGreenConquestColors[i]);
-        }
-        return;
+        streamFallback = currentMode;
+        stream.restart(now);
+        lastStreamLog = now;
+        lastStreamFrames = stream.stats().frames;
     }
-
-    // Check if all LEDs are the same color (converged to red or green)
-    bool allSame = true;
-    uint32_t refColor = redGreenConquestColors[0];
-    for (int i = 1; i < NUM_LEDS; i++)
+    if (transition.active())
     {
-        if (redGreenConquestColors[i] != refColor)
-        {
-            allSame = false;
-            break;
-        }
+        endCrossfade(); // a change mid-fade fades from the incoming mode alone
     }
-    if (allSame)
+    if (crossfadeMs)
     {
-        redGreenConquestConverged = true;
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, refColor);
-        }
-        return;
+        // The current mode keeps running in its slot, drawing into fadeFrame
+        memcpy(fadeFrame, strip.frame(), strip.numPixels() * 3);
+        transition.outgoing = scheduler;
+        transition.outgoingRng = rng;
+        transition.outgoingMode = currentMode;
+        transition.begin(now, crossfadeMs);
+        strip.crossfade(fadeFrame, 0);
+        currentSlot = !currentSlot;
     }
-
-    // Advance one iteration: each LED has a low chance (~6%) to take over each neighbor
-    // Use BSS buffer — stack cannot hold 300 * 4 bytes on ESP-01
-    for (int i = 0; i < NUM_LEDS; i++)
+    else
     {
-        redGreenConquestNewColors[i] = redGreenConquestColors[i];
+        modes[currentMode].exit(modeSlot(currentSlot));
     }
+    currentMode = mode;
+    Serial.print(F("New mode: "));
+    Serial.println(modes[mode].name);
+    setLedsOff();
+    rng.seedMode(mode);
+    modes[mode].enter(modeSlot(currentSlot));
+    scheduler.restart(now);
+}
 
-    for (int i = 0; i < NUM_LEDS; i++)
-    {
-        if (i > 0 && random(100) < 6)  // Low chance to conquer left neighbor
-        {
-            redGreenConquestNewColors[i - 1] = redGreenConquestColors[i];
-        }
-        if (i < NUM_LEDS - 1 && random(100) < 6)  // Low chance to conquer right neighbor
-        {
-            redGreenConquestNewColors[i + 1] = redGreenConquestColors[i];
-        }
-        if ((i & 31) == 0)
-        {
-            feedWatchdog();
-        }
-    }
+void setPixel(int pixel, byte red, byte green, byte blue)
+{
+    strip.setPixelColor(pixel, strip.Color(red, green, blue));
+}
 
-    // Commit new state
-    for (int i = 0; i < NUM_LEDS; i++)
+void setAll(byte red, byte green, byte blue)
+{
+    for (int i = 0; i < strip.numPixels(); i++)
     {
-        redGreenConquestColors[i] = redGreenConquestNewColors[i];
-        strip.setPixelColor(i, redGreenConquestColors[i]);
+        strip.setPixelColor(i, strip.Color(red, green, blue));
     }
 }
 
+// Seeding palettes; channels are drawn in the order listed
+Grb randomConquestColor()
+{
+    uint8_t r = rng.below(60); // Ensure reasonably bright colors
+    uint8_t g = rng.below(60);
+    uint8_t b = rng.below(60);
+    return grb(r, g, b);
+}
 
-void rainbowFlow() {
-    static uint16_t hue = 0;
-    static uint8_t sparkles[NUM_LEDS] = {0};
-    static uint8_t sparkleColors[NUM_LEDS][3] = {{0}};
-    static unsigned long lastUpdate = 0;
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdate >= random(15, 30))
+Grb redGreenConquestColor()
+{
+    if (rng.percent(50))
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            sparkles[i] = max(0, sparkles[i] - 20);
-            uint8_t r, g, b;
-            if (sparkles[i] > 0) {
-                r = sparkleColors[i][0];
-                g = sparkleColors[i][1];
-                b = sparkleColors[i][2];
-            }
-            else {
-                uint16_t h = hue + (i * 65536L / NUM_LEDS);
-                uint8_t s = 255;
-                uint8_t v = (h < 21845) ? 150 + (sin((hue + i * 100) * 0.01) + 1) * 25 : 100 + (sin((hue + i * 100) * 0.01) + 1) * 50;
-                uint32_t c = strip.ColorHSV(h, s, v);
-                r = (c >> 16) & 0xFF;
-                g = (c >> 8) & 0xFF;
-                b = c & 0xFF;
-            }
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-        if (random(100) < 10) {
-            for (int j = 0; j < random(1, 4); j++) {
-                int spark = random(NUM_LEDS);
-                sparkles[spark] = random(180, 255);
-                uint8_t sparkType = random(3);
-                if (sparkType == 0)
-                {
-                    sparkleColors[spark][0] = sparkles[spark];
-                    sparkleColors[spark][1] = sparkles[spark];
-                    sparkleColors[spark][2] = sparkles[spark];
-                }
-                else if (sparkType == 1)
-                { // Gold
-                    sparkleColors[spark][0] = sparkles[spark];
-                    sparkleColors[spark][1] = sparkles[spark] * 200 / 255;
-                    sparkleColors[spark][2] = sparkles[spark] * 50 / 255;
-                }
-                else
-                { // Neon pink
-                    sparkleColors[spark][0] = sparkles[spark] * 255 / 255;
-                    sparkleColors[spark][1] = sparkles[spark] * 105 / 255;
-                    sparkleColors[spark][2] = sparkles[spark] * 180 / 255;
-                }
-            }
-        }
-        hue += 512;
-        lastUpdate = currentTime;
+        return grb(0, 0, rng.range(5, 80)); // First half: random shades of red
     }
+    return grb(0, rng.range(5, 80), 0); // Second half: random shades of green
 }
 
-void setLedsRed()
+// Re-entering a conquest mode restarts it fresh.
+// Unique seed using hardware ID + analog noise - never repeats across devices or power cycles in practice
+struct RandomConquest : Conquest
 {
-    for (int i = 0; i < NUM_LEDS; i++)
+    RandomConquest(uint16_t n) : Conquest(n) { seed(ESP.getChipId() ^ (uint32_t)analogRead(A0), randomConquestColor); }
+};
+
+// Unique seed (different base for variety)
+struct RedGreenConquest : Conquest
+{
+    RedGreenConquest(uint16_t n) : Conquest(n)
     {
-        strip.setPixelColor(i, strip.Color(255, 0, 0));
+        seed(ESP.getChipId() ^ (uint32_t)analogRead(A0) ^ 0xDEADBEEF, redGreenConquestColor);
     }
-}
+};
 
-void setLedsOff()
+// Static frames: repaint once a second, and show() sends nothing unless they changed
+struct ConstantOff
 {
-    for (int i = 0; i < NUM_LEDS; i++)
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        strip.setPixelColor(i, strip.Color(0, 0, 0));
+        strip.fill(grb(0, 0, 0));
+        return 1000;
     }
-}
+};
 
-void proletariatCrackle()
+struct ConstantRed
 {
-    static uint8_t intensities[NUM_LEDS] = {0};
-    static unsigned long lastCrackle = 0;
-    unsigned long currentTime = millis();
-    if (currentTime - lastCrackle >= random(30, 100))
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            intensities[i] = max((uint8_t)0, (uint8_t)(intensities[i] - random(5, 15)));
-            uint8_t r = min(255, 255 * intensities[i] / 255);
-            uint8_t g = intensities[i] / 10;
-            strip.setPixelColor(i, strip.Color(r, g, 0));
-        }
-        for (int i = 0; i < 8; i++)
-        {
-            int led = random(NUM_LEDS);
-            intensities[led] = random(50, 255);
-        }
-        lastCrackle = currentTime;
+        strip.fill(grb(255, 0, 0));
+        return 1000;
     }
+};
+
+// Frames arrive over UDP (led_stream.h) and loop() shows each as it is
+// pushed; stepping draws nothing
+struct Streamed
+{
+    uint16_t step(DirtyStrip &, uint32_t) { return 1000; }
+};
+
+void setLedsOff()
+{
+    strip.fill(grb(0, 0, 0));
 }
 
-void somaHaze()
+struct SomaHaze
 {
-    static uint16_t pinkOffset = 0;
-    static uint16_t blueOffset = 0;
-    static unsigned long lastMorph = 0;
-    if (millis() - lastMorph >= 20)
+    uint16_t pinkOffset = 0;
+    uint16_t blueOffset = 0;
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            float pinkBlend = (sin((float)(i + pinkOffset) * 0.08f) + 1.0f) / 2.0f;
-            float blueBlend = (cos((float)(i + blueOffset) * 0.06f) + 1.0f) / 2.0f;
-            uint8_t r = (uint8_t)(255 * pinkBlend + 173 * blueBlend);
-            uint8_t g = (uint8_t)(192 * pinkBlend + 216 * blueBlend);
-            uint8_t b = (uint8_t)(203 * pinkBlend + 230 * blueBlend);
-            float morphFactor = (sin((float)i * 0.1f + (float)pinkOffset * 0.05f) + 1.0f) / 2.0f;
-            r = (uint8_t)(r * morphFactor + (255 - r) * (1 - morphFactor) / 2);
-            b = (uint8_t)(b * (1 - morphFactor) + (255 - b) * morphFactor / 2);
-            strip.setPixelColor(i, strip.Color(r, g, b));
+        constexpr uint32_t pinkRate = trigRate(0.08f);
+        constexpr uint32_t blueRate = trigRate(0.06f);
+        constexpr uint32_t morphRate = trigRate(0.1f);
+        uint32_t pinkPhase = pinkOffset * pinkRate;
+        uint32_t bluePhase = blueOffset * blueRate;
+        uint32_t morphPhase = pinkOffset * trigRate(0.05f);
+        Grb *px = strip.frame();
+        for (int i = 0; i < strip.numPixels(); i++)
+        {
+            // Q16 blends; channel sums past 255 wrap like the old float casts.
+            // A sum within an LSB of 256 can land on the other side of the
+            // wrap from the float one, flipping that channel between bright
+            // and dark: about 1 pixel in 17000 over a full cycle.
+            uint32_t pinkBlend = sinBlend16(pinkPhase);
+            uint32_t blueBlend = cosBlend16(bluePhase);
+            uint8_t r = (uint8_t)((255 * pinkBlend + 173 * blueBlend) >> 16);
+            uint8_t g = (uint8_t)((192 * pinkBlend + 216 * blueBlend) >> 16);
+            uint8_t b = (uint8_t)((203 * pinkBlend + 230 * blueBlend) >> 16);
+            uint32_t morph = sinBlend16(morphPhase);
+            r = (uint8_t)((r * morph + (255 - r) * (65536 - morph) / 2) >> 16);
+            b = (uint8_t)((b * (65536 - morph) + (255 - b) * morph / 2) >> 16);
+            px[i] = grb(r, g, b);
+            pinkPhase += pinkRate;
+            bluePhase += blueRate;
+            morphPhase += morphRate;
         }
         pinkOffset += 2;
         blueOffset -= 3;
-        lastMorph = millis();
+        return 20;
     }
-}
+};
 
-void loonieFreefall()
+struct BokanovskyBurst
 {
-    static uint8_t comets[10][3] = {0}; // pos, length, speed
-    static unsigned long lastFall = 0;
-    if (millis() - lastFall >= 25)
+    uint16_t n = strip.numPixels();
+    Particles<8> balls = Particles<8>::spread(n, {2, -2, 3, -3, 2, -2, 4, -4});
+    Trail<Grb, 10> trail{grb(255, 255, 0), [](uint8_t t)
+                         {
+                             uint8_t intensity = 255 - t * 25;
+                             return grb(intensity, intensity / 2, 0);
+                         }};
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, strip.Color(0, 0, 20)); // Galactic background
-        }
-        for (int c = 0; c < 10; c++)
+        Grb *px = strip.frame();
+        strip.fill(grb(50, 50, 50)); // Uniform base
+        auto draw = [&](uint16_t b)
         {
-            if (comets[c][0] == 0 && random(100) < 8)
+            if (balls.onStrip(b, n))
             {
-                comets[c][0] = 1; // Start new comet
-                comets[c][1] = random(5, 15); // Length
-                comets[c][2] = random(2, 5); // Speed
-            }
-            if (comets[c][0] > 0)
-            {
-                for (int t = 0; t < comets[c][1]; t++)
-                {
-                    int pos = comets[c][0] + t;
-                    if (pos < NUM_LEDS)
-                    {
-                        uint8_t intensity = 255 - t * (255 / comets[c][1]);
-                        uint8_t r = intensity;
-                        uint8_t g = intensity / 2;
-                        uint8_t b = intensity;
-                        strip.setPixelColor(pos, strip.Color(r, g, b));
-                    }
-                }
-                comets[c][0] += comets[c][2];
-                if (comets[c][0] + comets[c][1] >= NUM_LEDS)
-                {
-                    comets[c][0] = 0;
-                }
+                // Trails both ways
+                drawTrail(px, n, balls.pos[b], 1, trail);
+                drawTrail(px, n, balls.pos[b], -1, trail);
             }
-        }
-        lastFall = millis();
-    }
-}
-
-void bokanovskyBurst()
-{
-    static int balls[8] = {0, 40, 80, 120, 160, 200, 240, 280};
-    static int directions[8] = {2, -2, 3, -3, 2, -2, 4, -4};
-    static unsigned long lastBounce = 0;
-    if (millis() - lastBounce >= 20)
-    {
-        for (int i = 0; i < NUM_LEDS; i++)
+        };
+        auto burst = [&](int16_t at)
         {
-            strip.setPixelColor(i, strip.Color(50, 50, 50)); // Uniform base
-        }
-        for (int b = 0; b < 8; b++)
-        {
-            int pos = balls[b];
-            if (pos >= 0 && pos < NUM_LEDS)
-            {
-                strip.setPixelColor(pos, strip.Color(255, 255, 0));
-                for (int t = 1; t < 10; t++)
-                {
-                    int trail1 = pos - t * directions[b] / abs(directions[b]);
-                    int trail2 = pos + t * directions[b] / abs(directions[b]);
-                    uint8_t intensity = 255 - t * 25;
-                    if (trail1 >= 0 && trail1 < NUM_LEDS)
-                        strip.setPixelColor(trail1, strip.Color(intensity, intensity / 2, 0));
-                    if (trail2 >= 0 && trail2 < NUM_LEDS)
-                        strip.setPixelColor(trail2, strip.Color(intensity, intensity / 2, 0));
-                }
-            }
-            balls[b] += directions[b];
-            if (balls[b] <= 0 || balls[b] >= NUM_LEDS - 1)
+            for (int burst = -20; burst <= 20; burst++)
             {
-                directions[b] = -directions[b];
-                for (int burst = -20; burst <= 20; burst++)
+                int burstPos = at + burst;
+                if (burstPos >= 0 && burstPos < n)
                 {
-                    int burstPos = balls[b] + burst;
-                    if (burstPos >= 0 && burstPos < NUM_LEDS)
-                    {
-                        uint8_t br = random(200, 255);
-                        uint8_t bg = random(100, 200);
-                        uint8_t bb = random(0, 50);
-                        strip.setPixelColor(burstPos, strip.Color(br, bg, bb));
-                    }
+                    uint8_t br = rng.range(200, 255);
+                    uint8_t bg = rng.range(100, 200);
+                    uint8_t bb = rng.below(50);
+                    px[burstPos] = grb(br, bg, bb);
                 }
             }
-        }
-        lastBounce = millis();
+        };
+        balls.bounce(n, draw, burst);
+        return 20;
     }
-}
+};
 
-void totalPerspectiveVortex()
+struct TotalPerspectiveVortex
 {
-    static uint16_t marqueePos = 0;
-    static unsigned long lastMarquee = 0;
-    if (millis() - lastMarquee >= 15)
+    uint16_t marqueePos = 0;
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            uint16_t h = (marqueePos + i * 10) % 65536;
-            uint32_t color = strip.ColorHSV(h, 255, 255);
-            strip.setPixelColor(i, color);
-        }
+        uint16_t n = strip.numPixels();
+        fillGradient(strip, 0, n, marqueePos, 10);
         marqueePos += 256;
-        if (random(100) < 10)
+        if (rng.percent(10))
         {
-            int slingPos = random(NUM_LEDS);
+            int slingPos = rng.below(n);
             for (int s = 0; s < 50; s++)
             {
-                int pos = (slingPos + s * 5) % NUM_LEDS;
-                strip.setPixelColor(pos, strip.ColorHSV(random(65536), 255, 255));
+                int pos = (slingPos + s * 5) % n;
+                strip.frame()[pos] = grb(colorHSV(rng.bits(16)));
             }
         }
-        lastMarquee = millis();
+        return 15;
     }
-}
+};
+
+constexpr Palette orangePalette PROGMEM = makePalette([](uint8_t i) { return grb(i, i / 2, 0); });
 
-void golgafrinchamDrift()
+struct GolgafrinchamDrift
 {
-    static uint8_t comets[NUM_LEDS] = {0};
-    static int cometPositions[8] = {0, 37, 75, 112, 150, 187, 225, 262};
-    static int cometSpeeds[8] = {1, 2, 1, 3, 2, 1, 4, 2};
-    static int cometDirections[8] = {1, 1, 1, 1, 1, 1, 1, 1};
-    static unsigned long lastSurge = 0;
-    if (millis() - lastSurge >= 35)
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n = strip.numPixels();
+    uint8_t *glow = ledBuffer<uint8_t>(n);
+    Particles<8> comets = Particles<8>::spread(n, {1, 2, 1, 3, 2, 1, 4, 2});
+    Trail<uint8_t, 8> trail{255, [](uint8_t t) { return (uint8_t)(255 - t * 30); }};
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            comets[i] = max(0, comets[i] - 15);
-            uint8_t r = comets[i];
-            uint8_t g = comets[i] / 2; // Comet surges for Golgafrincham ship drift, orange trails
-            uint8_t b = 0;
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
+        fadeBy(glow, n, 15);
+        colorize(strip.frame(), glow, n, orangePalette); // Comet surges for Golgafrincham ship drift, orange trails
         for (int c = 0; c < 8; c++)
         {
-            cometPositions[c] = (cometPositions[c] + cometSpeeds[c] * cometDirections[c] + NUM_LEDS) % NUM_LEDS;
-            comets[cometPositions[c]] = 255;
-            for (int tail = 1; tail < 8; tail++)
+            // Faster comets space their tails out further
+            comets.wrap(c, n);
+            drawTrailRing(glow, n, comets.pos[c], comets.vel[c], trail, Lighten());
+            if (rng.percent(2))
             {
-                int tailPos = (cometPositions[c] - tail * cometSpeeds[c] * cometDirections[c] + NUM_LEDS) % NUM_LEDS;
-                comets[tailPos] = max(comets[tailPos], (uint8_t)(255 - tail * 30));
-            }
-            if (random(100) < 2)
-            {
-                cometDirections[c] = -cometDirections[c];
-                cometSpeeds[c] = random(1, 5);
+                comets.vel[c] = -comets.heading(c) * rng.range(1, 5);
             }
         }
-        lastSurge = millis();
+        return 35;
     }
-}
+};
 
-void bistromathicsSurge()
+struct NewspeakShrink
 {
-    static int ballPositions[5] = {0, 60, 120, 180, 240};
-    static int ballDirections[5] = {1, -1, 1, -1, 1};
-    static uint8_t intensities[NUM_LEDS] = {0};
-    static unsigned long lastBounce = 0;
-    if (millis() - lastBounce >= 25)
-    {
-        memset(intensities, 0, sizeof(intensities));
-        for (int b = 0; b < 5; b++)
-        {
-            intensities[ballPositions[b]] = 255;
-            // Bouncing ball trails for mathematical chaos
-            for (int t = 1; t < 6; t++)
-            {
-                int trailPos = ballPositions[b] - t * ballDirections[b] * 2;
-                if (trailPos >= 0 && trailPos < NUM_LEDS)
-                {
-                    intensities[trailPos] = max(intensities[trailPos], (uint8_t)(255 - t * 40));
-                }
-            }
-            ballPositions[b] += ballDirections[b] * 3;
-            if (ballPositions[b] >= NUM_LEDS - 1 || ballPositions[b] <= 0)
-            {
-                ballDirections[b] = -ballDirections[b];
-            }
-        }
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            uint8_t r = intensities[i] * (random(2)); // Chaotic colors
-            uint8_t g = intensities[i] * (random(2));
-            uint8_t b = intensities[i] * (random(2));
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-        lastBounce = millis();
-    }
-}
+    static constexpr uint8_t ledBytes = 1;
 
-void groksDissolution()
-{
-    static uint8_t slings[4] = {0, 75, 150, 225};
-    static int slingDirs[4] = {5, -4, 6, -5};
-    static unsigned long lastSling = 0;
-    if (millis() - lastSling >= 30)
-    {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, strip.Color(0, 20, 0)); // Deep green base
-        }
-        for (int s = 0; s < 4; s++)
-        {
-            int pos = slings[s];
-            if (pos >= 0 && pos < NUM_LEDS)
-            {
-                strip.setPixelColor(pos, strip.Color(50, 255, 50));
-                for (int t = 1; t < 15; t++)
-                {
-                    int trail = pos - t * slingDirs[s] / abs(slingDirs[s]);
-                    if (trail >= 0 && trail < NUM_LEDS)
-                    {
-                        uint8_t intensity = 200 - t * 13;
-                        strip.setPixelColor(trail, strip.Color(20, intensity, 20));
-                    }
-                }
-            }
-            slings[s] += slingDirs[s];
-            if (slings[s] <= 0 || slings[s] >= NUM_LEDS - 1)
-            {
-                slingDirs[s] = -slingDirs[s];
-                int rippleCenter = slings[s];
-                for (int r = 0; r < 30; r++)
-                {
-                    int left = rippleCenter - r;
-                    int right = rippleCenter + r;
-                    if (left >= 0)
-                        strip.setPixelColor(left, strip.Color(100, 255, 100));
-                    if (right < NUM_LEDS)
-                        strip.setPixelColor(right, strip.Color(100, 255, 100));
-                }
-            }
-        }
-        lastSling = millis();
-    }
-}
+    uint16_t n = strip.numPixels();
+    uint8_t *intensities = ledBuffer<uint8_t>(n);
+    int leftPos = 0;
+    int rightPos = n - 1;
+    bool converging = true;
 
-void newspeakShrink()
-{
-    static uint8_t intensities[NUM_LEDS] = {0};
-    static int leftPos = 0;
-    static int rightPos = NUM_LEDS - 1;
-    static bool converging = true;
-    static unsigned long lastShrink = 0;
-    if (millis() - lastShrink >= 30)
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
+        Grb *px = strip.frame();
+        fadeBy(intensities, n, 10);
+        for (int i = 0; i < n; i++)
         {
-            intensities[i] = max(0, intensities[i] - 10);
             uint8_t r = intensities[i] * (i % 3 == 0 ? 0.5 : 0);
             uint8_t g = intensities[i] * (i % 3 == 1 ? 0.5 : 0);
             uint8_t b = intensities[i]; // Blues and grays shrinking
-            strip.setPixelColor(i, strip.Color(r, g, b));
+            px[i] = grb(r, g, b);
         }
         if (converging)
         {
             for (int d = 0; d < 10; d++)
             {
-                if (leftPos + d < NUM_LEDS)
+                if (leftPos + d < n)
                     intensities[leftPos + d] = (uint8_t)(255 - d * 20);
                 if (rightPos - d >= 0)
                     intensities[rightPos - d] = (uint8_t)(255 - d * 20);
@@ -1009,334 +758,410 @@ void newspeakShrink()
             {
                 if (leftPos - d >= 0)
                     intensities[leftPos - d] = (uint8_t)(255 - d * 20);
-                if (rightPos + d < NUM_LEDS)
+                if (rightPos + d < n)
                     intensities[rightPos + d] = (uint8_t)(255 - d * 20);
             }
             leftPos -= 5;
             rightPos += 5;
-            if (leftPos <= 0 || rightPos >= NUM_LEDS - 1)
+            if (leftPos <= 0 || rightPos >= n - 1)
             {
                 converging = true;
             }
         }
-        lastShrink = millis();
+        return 30;
     }
-}
+};
 
-void noliteTeBastardes()
+struct NoliteTeBastardes
 {
-    static int slingPositions[6] = {0, 50, 100, 150, 200, 250};
-    static int slingSpeeds[6] = {4, -5, 6, -4, 5, -6};
-    static unsigned long lastSling = 0;
-    if (millis() - lastSling >= 25)
+    uint16_t n = strip.numPixels();
+    Particles<6> slings = Particles<6>::spread(n, {4, -5, 6, -4, 5, -6});
+    Trail<Grb, 12> trail{grb(255, 100, 0), [](uint8_t t)
+                         {
+                             uint8_t intensity = 220 - t * 18;
+                             return grb(intensity, intensity / 3, 0);
+                         }};
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
+        Grb *px = strip.frame();
+        strip.fill(grb(20, 0, 0)); // Dark red base
+        auto draw = [&](uint16_t s)
         {
-            strip.setPixelColor(i, strip.Color(20, 0, 0)); // Dark red base
-        }
-        for (int s = 0; s < 6; s++)
-        {
-            int pos = slingPositions[s];
-            if (pos >= 0 && pos < NUM_LEDS)
+            if (slings.onStrip(s, n))
             {
-                strip.setPixelColor(pos, strip.Color(255, 100, 0));
-                for (int t = 1; t < 12; t++)
-                {
-                    int trail = pos - t * slingSpeeds[s] / abs(slingSpeeds[s]);
-                    if (trail >= 0 && trail < NUM_LEDS)
-                    {
-                        uint8_t intensity = 220 - t * 18;
-                        strip.setPixelColor(trail, strip.Color(intensity, intensity / 3, 0));
-                    }
-                }
+                drawTrail(px, n, slings.pos[s], slings.heading(s), trail);
             }
-            slingPositions[s] += slingSpeeds[s];
-            if (slingPositions[s] <= 0 || slingPositions[s] >= NUM_LEDS - 1)
+        };
+        auto burst = [&](int16_t at)
+        {
+            for (int b = -15; b <= 15; b++)
             {
-                slingSpeeds[s] = -slingSpeeds[s];
-                int burstCenter = slingPositions[s];
-                for (int b = -15; b <= 15; b++)
+                int burstPos = at + b;
+                if (burstPos >= 0 && burstPos < n)
                 {
-                    int burstPos = burstCenter + b;
-                    if (burstPos >= 0 && burstPos < NUM_LEDS)
-                    {
-                        strip.setPixelColor(burstPos, strip.Color(255, random(50, 150), 0));
-                    }
+                    px[burstPos] = grb(255, rng.range(50, 150), 0);
                 }
             }
-        }
-        lastSling = millis();
+        };
+        slings.bounce(n, draw, burst);
+        return 25;
     }
-}
+};
 
-void infiniteImprobabilityDrive()
+struct BigBrotherGlare
 {
-    static uint16_t hue = 0;
-    static unsigned long lastShift = 0;
-    if (millis() - lastShift >= 20)
-    {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            uint32_t c = strip.ColorHSV(hue + random(65536 / NUM_LEDS), 255, 255); // Random hue shifts for improbability, HHGTTG style
-            strip.setPixelColor(i, c);
-        }
-        if (random(100) < 10)
-        {
-            hue = random(65536); // Sudden "drive" jumps
-        }
-        else
-        {
-            hue += 500;
-        }
-        lastShift = millis();
-    }
-}
+    static constexpr uint8_t ledBytes = 1;
 
-void bigBrotherGlare()
-{
-    static uint8_t eyes[NUM_LEDS] = {0};
-    static unsigned long lastGlare = 0;
-    if (millis() - lastGlare >= 50)
+    uint16_t n = strip.numPixels();
+    uint8_t *eyes = ledBuffer<uint8_t>(n);
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            eyes[i] = max(0, eyes[i] - 10);
-            uint8_t r = eyes[i];
-            uint8_t g = 0;
-            uint8_t b = 0; // Red glare for 1984 surveillance
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
+        fadeBy(eyes, n, 10);
+        colorize(strip.frame(), eyes, n, redPalette); // Red glare for 1984 surveillance
         // Periodic "eyes" lighting up
         for (int e = 0; e < 3; e++)
         {
-            int pos = random(NUM_LEDS);
+            int pos = rng.below(n);
             eyes[pos] = 255;
-            eyes[(pos + 1) % NUM_LEDS] = 200; // Paired eyes
+            eyes[(pos + 1) % n] = 200; // Paired eyes
         }
-        lastGlare = millis();
+        return 50;
     }
-}
+};
+
+constexpr Palette replicantPalette PROGMEM = makePalette([](uint8_t i) { return grb(i / 2, i / 2, i); });
 
-void replicantRetirement()
+struct ReplicantRetirement
 {
-    static int pulseCenters[5] = {0, 60, 120, 180, 240};
-    static uint8_t pulseRadii[5] = {0};
-    static unsigned long lastPulse = 0;
-    if (millis() - lastPulse >= 25)
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n = strip.numPixels();
+    int pulseCenters[5] = {0, (int)n / 5, 2 * (int)n / 5, 3 * (int)n / 5, 4 * (int)n / 5};
+    uint8_t pulseRadii[5] = {0};
+    Falloff<40> falloff{[](uint8_t d) { return (uint8_t)(255 - d * 8); }};
+    uint8_t *intensities = ledBuffer<uint8_t>(n); // cleared again as each frame is colored
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
+        for (int p = 0; p < 5; p++)
         {
-            uint8_t intensity = 0;
-            for (int p = 0; p < 5; p++)
-            {
-                int dist = abs(i - pulseCenters[p]);
-                if (dist <= pulseRadii[p])
-                {
-                    intensity = max(intensity, (uint8_t)(255 - dist * 8));
-                }
-            }
-            uint8_t r = intensity / 2;
-            uint8_t g = intensity / 2;
-            uint8_t b = intensity;
-            strip.setPixelColor(i, strip.Color(r, g, b));
+            drawRipple(intensities, n, pulseCenters[p], pulseRadii[p], falloff);
+        }
+        Grb *px = strip.frame();
+        for (int i = 0; i < n; i++)
+        {
+            px[i] = replicantPalette[intensities[i]];
+            intensities[i] = 0;
         }
         for (int p = 0; p < 5; p++)
         {
             pulseRadii[p] += 2;
-            if (pulseRadii[p] >= 40 || random(100) < 10)
+            if (pulseRadii[p] >= 40 || rng.percent(10))
             {
-                pulseCenters[p] = random(NUM_LEDS);
+                pulseCenters[p] = rng.below(n);
                 pulseRadii[p] = 0;
             }
         }
-        lastPulse = millis();
+        return 25;
     }
-}
+};
 
-void waterBrotherBond()
+struct WaterBrotherBond
 {
-    static int balls[10] = {0};
-    static int dirs[10] = {0};
-    static unsigned long lastBounce = 0;
-    if (millis() - lastBounce >= 20)
+    uint16_t n = strip.numPixels();
+    Particles<10> balls;
+    Trail<Grb, 8> trail{grb(0, 255, 255), [](uint8_t t)
+                        {
+                            uint8_t intensity = 200 - t * 25;
+                            return grb(0, intensity, intensity);
+                        }};
+
+    WaterBrotherBond()
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            strip.setPixelColor(i, strip.Color(0, 50, 100)); // Bond base
-        }
         for (int b = 0; b < 10; b++)
         {
-            if (dirs[b] == 0)
-            {
-                balls[b] = random(NUM_LEDS);
-                dirs[b] = random(2) ? 3 : -3;
-            }
-            int pos = balls[b];
-            strip.setPixelColor(pos, strip.Color(0, 255, 255));
-            for (int t = 1; t < 8; t++)
-            {
-                int trail = pos - t * dirs[b] / 3;
-                if (trail >= 0 && trail < NUM_LEDS)
-                {
-                    uint8_t intensity = 200 - t * 25;
-                    strip.setPixelColor(trail, strip.Color(0, intensity, intensity));
-                }
-            }
-            balls[b] += dirs[b];
-            if (balls[b] <= 0 || balls[b] >= NUM_LEDS - 1)
-            {
-                dirs[b] = -dirs[b];
-                int ripple = balls[b];
-                for (int r = -20; r <= 20; r++)
-                {
-                    int rp = ripple + r;
-                    if (rp >= 0 && rp < NUM_LEDS)
-                    {
-                        strip.setPixelColor(rp, strip.Color(100, 255, 255));
-                    }
-                }
-            }
+            balls.pos[b] = rng.below(n);
+            balls.vel[b] = rng.coin() ? 3 : -3;
         }
-        lastBounce = millis();
     }
-}
 
-void hypnopaediaHum()
-{
-    static uint16_t marqueePos = 0;
-    static unsigned long lastHum = 0;
-    if (millis() - lastHum >= 40)
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            float hum = (sin((float)(i + marqueePos) * 0.05f) + 1.0f) / 2.0f;
-            uint8_t r = (uint8_t)(100 * hum);
-            uint8_t g = (uint8_t)(150 * hum);
-            uint8_t b = (uint8_t)(200 * hum);
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-        marqueePos += 2;
-        if (random(100) < 10)
-        {
-            int slingStart = random(NUM_LEDS);
-            for (int s = 0; s < 40; s++)
+        Grb *px = strip.frame();
+        strip.fill(grb(0, 50, 100)); // Bond base
+        // Trails stay visible while a ball is briefly past the end
+        auto draw = [&](uint16_t b) { drawTrail(px, n, balls.pos[b], balls.heading(b), trail); };
+        auto ripple = [&](int16_t at)
+        {
+            int rippleStart = max(0, at - 20);
+            int rippleEnd = min((int)n, at + 21);
+            if (rippleStart < rippleEnd)
             {
-                int pos = (slingStart + s * 4) % NUM_LEDS;
-                strip.setPixelColor(pos, strip.Color(255, 255, 255));
+                strip.fill(grb(100, 255, 255), rippleStart, rippleEnd - rippleStart);
             }
-        }
-        lastHum = millis();
+        };
+        balls.bounce(n, draw, ripple);
+        return 20;
     }
-}
+};
 
-void vogonPoetryPulse()
+struct HypnopaediaHum
 {
-    static uint8_t ripples[NUM_LEDS] = {0};
-    static int rippleCenters[4] = {0};
-    static unsigned long lastRipple = 0;
-    if (millis() - lastRipple >= 60)
+    uint16_t marqueePos = 0;
+
+    uint16_t step(DirtyStrip &strip, uint32_t)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
+        constexpr uint32_t rate = trigRate(0.05f);
+        uint32_t phase = marqueePos * rate;
+        uint16_t n = strip.numPixels();
+        Grb *px = strip.frame();
+        for (int i = 0; i < n; i++)
         {
-            ripples[i] = max(0, ripples[i] - 8);
-            uint8_t r = ripples[i] / 2;
-            uint8_t g = ripples[i] * 3 / 4;
-            uint8_t b = ripples[i] / 3;
-            strip.setPixelColor(i, strip.Color(r, g, b));
+            uint16_t hum = sinBlend16(phase);
+            px[i] = grb(scaleBlend16(100, hum), scaleBlend16(150, hum), scaleBlend16(200, hum));
+            phase += rate;
         }
-        for (int rc = 0; rc < 4; rc++)
+        marqueePos += 2;
+        if (rng.percent(10))
         {
-            if (random(100) < 25)
-            {
-                rippleCenters[rc] = random(NUM_LEDS);
-            }
-            for (int d = 0; d < 20; d++)
+            int slingStart = rng.below(n);
+            for (int s = 0; s < 40; s++)
             {
-                int left = rippleCenters[rc] - d;
-                int right = rippleCenters[rc] + d;
-                uint8_t intensity = 150 - d * 7;
-                if (left >= 0)
-                    ripples[left] = max(ripples[left], intensity);
-                if (right < NUM_LEDS)
-                    ripples[right] = max(ripples[right], intensity);
+                int pos = (slingStart + s * 4) % n;
+                px[pos] = grb(255, 255, 255);
             }
         }
-        lastRipple = millis();
+        return 40;
     }
-}
+};
 
-void thoughtPoliceFlash()
+constexpr Palette bluePalette PROGMEM = makePalette([](uint8_t i) { return grb(0, 0, i); });
+
+struct ThoughtPoliceFlash
 {
-    static uint8_t flashes[NUM_LEDS] = {0};
-    static uint8_t flameIntensities[20] = {0};
-    static unsigned long lastFlash = 0;
-    if (millis() - lastFlash >= 25)
+    static constexpr uint8_t ledBytes = 1;
+
+    uint16_t n = strip.numPixels();
+    uint8_t *flashes = ledBuffer<uint8_t>(n);
+    uint8_t flameIntensities[20] = {0};
+    uint32_t flameClock = 0; // ms of flame pulse, advanced by each step's delta
+
+    uint16_t step(DirtyStrip &strip, uint32_t dtMs)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            flashes[i] = max(0, flashes[i] - 20);
-            uint8_t r = 0;
-            uint8_t g = 0;
-            uint8_t b = flashes[i]; // Blue flashes
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-        if (random(100) < 20)
+        flameClock += dtMs;
+        Grb *px = strip.frame();
+        fadeBy(flashes, n, 20);
+        colorize(px, flashes, n, bluePalette); // Blue flashes
+        if (rng.percent(20))
         {
-            int flashPos = random(NUM_LEDS);
+            int flashPos = rng.below(n);
             flashes[flashPos] = 255;
             // Flash cluster for police "raid"
             for (int c = -3; c <= 3; c++)
             {
-                int idx = (flashPos + c + NUM_LEDS) % NUM_LEDS;
+                int idx = (flashPos + c + n) % n;
                 flashes[idx] = max(flashes[idx], (uint8_t)(200 - abs(c) * 30));
             }
         }
         // Enhanced flame effects at ends with pulsing
+        constexpr uint32_t flameRate = trigRate(0.5f);
+        uint32_t flamePhase = flameClock * trigRate(1.0 / 200.0);
         for (int f = 0; f < 20; f++)
         {
-            flameIntensities[f] = random(150, 255) * (sin((float)millis() / 200.0f + f * 0.5f) + 1.0f) / 2.0f;
+            flameIntensities[f] = scaleBlend16(rng.range(150, 255), sinBlend16(flamePhase));
+            flamePhase += flameRate;
             uint8_t fr = flameIntensities[f];
-            uint8_t fg = flameIntensities[f] / 2 + random(0, 50);
-            uint8_t fb = random(0, 20);
-            strip.setPixelColor(f, strip.Color(fr, fg, fb));
-            strip.setPixelColor(NUM_LEDS - 1 - f, strip.Color(fr, fg, fb));
+            uint8_t fg = flameIntensities[f] / 2 + rng.below(50);
+            uint8_t fb = rng.below(20);
+            px[f] = px[n - 1 - f] = grb(fr, fg, fb);
         }
-        lastFlash = millis();
+        return 25;
     }
+};
+
+// Running modes' state lives here and nowhere else: two slots, so the outgoing
+// mode of a crossfade keeps its state, each holding a state struct followed by
+// its per-LED buffers. Sized for the strip in setup(); exit() leaves a slot
+// zeroed.
+uint8_t *modeArena = nullptr;
+size_t modeSlotSize = 0;
+
+template <typename State>
+State &modeState(void *slot)
+{
+    return *std::launder(reinterpret_cast<State *>(slot));
 }
 
-void electricSheepDream()
+// Shared patterns take the strip length; the sketch's own modes read it
+// from strip
+template <typename State>
+void enterState(void *slot)
 {
-    static uint8_t rippleCenters[5] = {0};
-    static uint8_t rippleRadii[5] = {0};
-    static unsigned long lastRipple = 0;
-    if (millis() - lastRipple >= 50)
+    size_t stateBytes = ledBufferBytes(sizeof(State));
+    openLedBuffers((uint8_t *)slot + stateBytes, modeSlotSize - stateBytes);
+    if constexpr (std::is_constructible_v<State, uint16_t>)
     {
-        for (int i = 0; i < NUM_LEDS; i++)
-        {
-            uint8_t intensity = 0;
-            for (int r = 0; r < 5; r++)
-            {
-                int dist = abs(i - rippleCenters[r]);
-                if (dist <= rippleRadii[r])
-                {
-                    intensity = max(intensity, (uint8_t)(255 - dist * 10));
-                }
-            }
-            uint8_t r = 0;
-            uint8_t g = min(255, intensity * 3 / 2);
-            uint8_t b = intensity / 4;
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-        for (int r = 0; r < 5; r++)
-        {
-            rippleRadii[r] = min(30, rippleRadii[r] + 1);
-            if (rippleRadii[r] >= 30 || random(100) < 5)
-            {
-                rippleCenters[r] = random(NUM_LEDS);
-                rippleRadii[r] = 0;
-            }
-        }
-        lastRipple = millis();
+        new (slot) State(strip.numPixels());
+    }
+    else
+    {
+        new (slot) State();
     }
+    closeLedBuffers();
+}
+
+template <typename State>
+void exitState(void *slot)
+{
+    modeState<State>(slot).~State();
+    memset(slot, 0, modeSlotSize);
+}
+
+template <typename State>
+uint16_t stepState(void *slot, uint32_t dtMs)
+{
+    return modeState<State>(slot).step(strip, dtMs);
+}
+
+template <typename State>
+constexpr ModeEntry modeEntry(const char *name)
+{
+    return {name, stepState<State>, enterState<State>, exitState<State>,
+            sizeof(State), alignof(State), LedBytes<State>::value};
+}
+
+constexpr ModeEntry modes[] = {
+    modeEntry<ConstantOff>("off"),
+    modeEntry<RainbowFlow<10, true>>("rainbow-flow"),
+    modeEntry<ConstantRed>("constant-red"),
+    modeEntry<ProletariatCrackle<>>("proletariat-crackle"),
+    modeEntry<SomaHaze>("soma-haze"),
+    modeEntry<LoonieFreefall>("loonie-freefall"),
+    modeEntry<BokanovskyBurst>("bokanovsky-burst"),
+    modeEntry<TotalPerspectiveVortex>("total-perspective-vortex"),
+    modeEntry<GolgafrinchamDrift>("golgafrincham-drift"),
+    modeEntry<BistromathicsSurge>("bistromathics-surge"),
+    modeEntry<GroksDissolution>("groks-dissolution"),
+    modeEntry<NewspeakShrink>("newspeak-shrink"),
+    modeEntry<NoliteTeBastardes>("nolite-te-bastardes"),
+    modeEntry<InfiniteImprobabilityDrive>("infinite-improbability-drive"),
+    modeEntry<BigBrotherGlare>("big-brother-glare"),
+    modeEntry<ReplicantRetirement>("replicant-retirement"),
+    modeEntry<WaterBrotherBond>("water-brother-bond"),
+    modeEntry<HypnopaediaHum>("hypnopaedia-hum"),
+    modeEntry<VogonPoetryPulse<>>("vogon-poetry-pulse"),
+    modeEntry<ThoughtPoliceFlash>("thought-police-flash"),
+    modeEntry<ElectricSheepDream<>>("electric-sheep-dream"),
+    modeEntry<RandomConquest>("random-conquest"),
+    modeEntry<RedGreenConquest>("red-green-conquest"),
+    modeEntry<Streamed>("stream"),
+};
+constexpr uint8_t modeCount = sizeof(modes) / sizeof(modes[0]);
+constexpr uint8_t modeStream = modeCount - 1;
+
+// Buffers are carved a word at a time, so slots stay at least word aligned
+constexpr size_t modeArenaAlign = []
+{
+    size_t largest = 4;
+    for (const ModeEntry &m : modes)
+    {
+        largest = std::max<size_t>(largest, m.stateAlign);
+    }
+    return largest;
+}();
+static_assert(modeArenaAlign <= alignof(max_align_t), "the heap cannot align the mode arena");
+
+// One slot on an n-LED strip: room for the largest mode's state and buffers
+constexpr size_t modeSlotBytes(uint16_t n)
+{
+    size_t largest = 0;
+    for (const ModeEntry &m : modes)
+    {
+        largest = std::max(largest, ledBufferBytes(m.stateSize) + ledBufferSpace(m.ledBytes, n));
+    }
+    return (largest + modeArenaAlign - 1) / modeArenaAlign * modeArenaAlign;
+}
+
+// What the arena costs against every mode keeping its own statics, which is
+// how this sketch used to hold them
+constexpr size_t modeArenaBytes(uint16_t n)
+{
+    return 2 * modeSlotBytes(n);
+}
+
+constexpr size_t separateModeBytes(uint16_t n)
+{
+    size_t total = 0;
+    for (const ModeEntry &m : modes)
+    {
+        total += m.stateSize + m.ledBytes * n;
+    }
+    return total;
+}
+
+// Heap the arena may take on the longest strip. The ESP8266 has about 40 KB
+// free with WiFi up; the strip's frame, wire bytes, dither residue and
+// crossfade frame take 12 bytes per LED of it (14 KB at 1200), and the TCP
+// and UDP buffers want the rest.
+constexpr size_t modeArenaBudget = 12288;
+static_assert(modeArenaBytes(maxStripLength) <= modeArenaBudget, "a mode's state outgrew the arena budget");
+static_assert(modeArenaBytes(maxStripLength) < separateModeBytes(maxStripLength),
+              "the arena should cost less than every mode keeping its own state");
+
+void allocateModeArena(uint16_t n)
+{
+    modeSlotSize = modeSlotBytes(n);
+    modeArena = (uint8_t *)calloc(2, modeSlotSize);
+    if (!modeArena)
+    {
+        outOfRam("No RAM for the mode arena");
+    }
+}
+
+// A stored length too long for the heap would fail the same way on every
+// boot, so go back to the default before restarting
+void outOfRam(const char *reason)
+{
+    if (storedStripLength && storedStripLength != DEFAULT_NUM_LEDS)
+    {
+        saveStripLength(DEFAULT_NUM_LEDS);
+    }
+    safeRestart(reason);
+}
+
+// Stores a strip length the server pushed (led_modepush.h) and restarts, as
+// everything sized from the length is allocated once in setup(). A length
+// already stored or in use is left alone, so the push that caused a restart,
+// replayed after it, cannot write the flash and restart again.
+void setStripLength(uint16_t leds)
+{
+    if (leds < minStripLength || leds > maxStripLength)
+    {
+        Serial.printf("Strip length %u out of range\n", leds);
+        return;
+    }
+    if (leds == storedStripLength || leds == strip.numPixels())
+    {
+        return;
+    }
+    saveStripLength(leds);
+    storedStripLength = leds;
+    safeRestart("Strip length changed");
+}
+
+uint8_t *modeSlot(uint8_t slot)
+{
+    return modeArena + slot * modeSlotSize;
+}
+
+// The same at the strip's actual length
+void logModeArena()
+{
+    size_t arena = modeArenaBytes(strip.numPixels());
+    size_t separate = separateModeBytes(strip.numPixels());
+    Serial.printf("Mode state: %u B arena; budget %u B at %u LEDs\n", (unsigned)arena, (unsigned)modeArenaBudget,
+                  maxStripLength);
+    Serial.printf("Mode state: %u B if each mode kept its own\n", (unsigned)separate);
 }
@@ -0,0 +1,226 @@
+#pragma once
+// random_led_pattern's states as a stream: one connection to the state
+// server, over which it sends states as fast as it makes them, packed eight
+// to a byte, instead of one JSON reply per connection. The stream is a run
+// of batches:
+//
+//   'B' count(u16 LE) bits...   ceil(count / 8) bytes, first state in bit 0
+//
+// A batch of 0 states is a keepalive; a server with nothing to send should
+// send one at least every idleTimeoutMs, or the strip takes the connection
+// for dead and opens another.
+//
+// poll() never waits on the server. The connection is ESPAsyncTCP's, as in
+// led_modefetch.h: WiFiClient::connect() would hold loop() for the whole
+// timeout on every retry while the server is down. Its callbacks, which the
+// SDK runs between passes of loop(), only note the connection's state and
+// copy arriving bytes into a fixed inbox; poll() unpacks them and hands each
+// state to the caller, so nothing is allocated after begin().
+#include <Arduino.h>
+#include <ESPAsyncTCP.h>
+#include <string.h>
+
+class StateStream
+{
+public:
+    static constexpr uint16_t inboxBytes = 512; // 4096 states between passes of loop()
+    static constexpr uint16_t idleTimeoutMs = 5000;
+
+    struct Stats
+    {
+        uint32_t connects;
+        uint32_t states;
+        uint32_t batches;   // keepalives included
+        uint32_t malformed; // connections dropped for a bad batch
+        uint32_t timeouts;  // connections dropped as silent
+        uint32_t overflows; // connections dropped as loop() fell too far behind
+    };
+
+    // timeoutMs bounds connecting; retryMs is the least time between attempts
+    void begin(const IPAddress &ip, uint16_t port, uint16_t timeoutMs, uint16_t retryMs)
+    {
+        this->ip = ip;
+        this->port = port;
+        this->timeoutMs = timeoutMs;
+        this->retryMs = retryMs;
+        client.onConnect([](void *self, AsyncClient *) { ((StateStream *)self)->open = true; }, this);
+        client.onDisconnect([](void *self, AsyncClient *) { ((StateStream *)self)->open = false; }, this);
+        client.onData([](void *self, AsyncClient *, void *data, size_t len)
+                      { ((StateStream *)self)->arrived((const uint8_t *)data, len); },
+                      this);
+    }
+
+    // Streaming, as the callbacks last said; false while it connects
+    bool connected() const { return open && !connecting; }
+
+    // Calls paint(state) for each state that has arrived, in order, and
+    // returns how many there were
+    template <typename Paint>
+    uint16_t poll(unsigned long now, Paint paint)
+    {
+        if (connecting)
+        {
+            waitForConnect(now);
+            return 0;
+        }
+        if (!open)
+        {
+            reconnect(now);
+            return 0;
+        }
+        if (overflowed)
+        {
+            Serial.println("State stream: inbox overflowed, reconnecting");
+            counts.overflows++;
+            drop();
+            return 0;
+        }
+        uint16_t states = 0;
+        if (inboxLength > 0)
+        {
+            uint16_t n = inboxLength;
+            inboxLength = 0;
+            lastByteAt = now;
+            for (uint16_t b = 0; b < n; b++)
+            {
+                if (!take(inbox[b], paint, states))
+                {
+                    Serial.println("State stream: malformed batch, reconnecting");
+                    counts.malformed++;
+                    drop();
+                    counts.states += states;
+                    return states;
+                }
+            }
+        }
+        if (now - lastByteAt >= idleTimeoutMs)
+        {
+            Serial.println("State stream: silent, reconnecting");
+            counts.timeouts++;
+            drop();
+        }
+        counts.states += states;
+        return states;
+    }
+
+    const Stats &stats() const { return counts; }
+
+private:
+    enum Part : uint8_t
+    {
+        Magic,
+        CountLow,
+        CountHigh,
+        Bits
+    };
+
+    // Starts opening the connection once retryMs has passed since the last try
+    void reconnect(unsigned long now)
+    {
+        if (attempted && now - attemptAt < retryMs)
+        {
+            return;
+        }
+        attempted = true;
+        attemptAt = now;
+        inboxLength = 0;
+        overflowed = false;
+        if (client.connect(ip, port))
+        {
+            connecting = true;
+        }
+    }
+
+    void waitForConnect(unsigned long now)
+    {
+        if (open)
+        {
+            connecting = false;
+            client.setNoDelay(true);
+            counts.connects++;
+            part = Magic;
+            lastByteAt = now;
+            Serial.println("State stream connected");
+            return;
+        }
+        if (client.disconnected())
+        {
+            connecting = false; // refused; try again after retryMs
+            return;
+        }
+        if (now - attemptAt > timeoutMs)
+        {
+            connecting = false;
+            client.abort();
+        }
+    }
+
+    // Runs in the SDK's context as bytes arrive; loop() unpacks them later
+    void arrived(const uint8_t *data, size_t len)
+    {
+        if (len > sizeof(inbox) - inboxLength)
+        {
+            overflowed = true; // a state lost would shift every one after it
+            return;
+        }
+        memcpy(inbox + inboxLength, data, len);
+        inboxLength += len;
+    }
+
+    // The next poll() starts over once retryMs has passed
+    void drop()
+    {
+        client.close(true);
+        open = false;
+    }
+
+    // Feeds one byte of the stream through the batch parser; false if the
+    // stream is not batches
+    template <typename Paint>
+    bool take(uint8_t byte, Paint &paint, uint16_t &states)
+    {
+        switch (part)
+        {
+        case Magic:
+            part = CountLow;
+            return byte == 'B';
+        case CountLow:
+            left = byte;
+            part = CountHigh;
+            return true;
+        case CountHigh:
+            left |= byte << 8;
+            counts.batches++;
+            part = left ? Bits : Magic;
+            return true;
+        case Bits:
+            for (uint8_t bit = 0; bit < 8 && left; bit++, left--)
+            {
+                paint(byte >> bit & 1);
+                states++;
+            }
+            part = left ? Bits : Magic;
+            return true;
+        }
+        return false;
+    }
+
+    AsyncClient client;
+    IPAddress ip;
+    uint16_t port = 0;
+    uint16_t timeoutMs = 1000;
+    uint16_t retryMs = 0;
+    bool open = false;       // connected, as the callbacks last said
+    bool connecting = false; // a connect() is waiting for the handshake
+    bool attempted = false;
+    unsigned long attemptAt = 0;
+    unsigned long lastByteAt = 0;
+    Part part = Magic;
+    uint16_t left = 0; // states still to come in this batch
+
+    // Bytes the callbacks took since loop() last unpacked
+    uint8_t inbox[inboxBytes];
+    uint16_t inboxLength = 0;
+    bool overflowed = false;
+    Stats counts = {};
+};
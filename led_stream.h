@@ -0,0 +1,226 @@
+#pragma once
+// Frames streamed to the strip over UDP in DDP (Distributed Display
+// Protocol), as xLights, WLED and similar renderers send it. A packet is a
+// 10-byte header and a run of RGB bytes for part of the frame:
+//
+//   flags      0x40 version 1, 0x10 timecode follows, 0x02 query, 0x01 push
+//   sequence   low 4 bits, 1..15 and round again; 0 when unused
+//   data type  0 or RGB; other formats are not taken
+//   id         1 is the strip; 0 is taken as 1
+//   offset     u32 big-endian, in bytes into the frame
+//   length     u16 big-endian
+//
+// Only data packets for the strip get as far as the frame, so only they can
+// take the strip over from the pattern mode. Queries, packets for other ids
+// (status, config) and anything that is not DDP are read off the socket and
+// counted, but never answered.
+//
+// A frame longer than one packet (300 pixels is 900 bytes; senders often cut
+// at 480 pixels or fewer) comes as fragments at their offsets. Each is read
+// from the UDP buffer straight into the strip's frame at its offset, then
+// swapped from RGB to wire order in place, so there is no copy of the frame.
+// The packet with push set ends the frame and asks for it to be shown.
+// Offsets and lengths must be whole pixels.
+//
+// A frame is dropped when a packet of it went missing, going by the sequence
+// numbers or by a fragment not starting where the last one ended, or when
+// its push did, which shows as the next frame starting over at an offset
+// already written. A dropped frame is never pushed: the strip keeps showing
+// the last whole frame, and the caller holds off showing the buffer until
+// frameReady() says a whole one is back in it.
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "led_strip.h"
+
+class StreamReceiver
+{
+public:
+    static constexpr uint8_t headerBytes = 10;
+    static constexpr uint8_t maxPacketsPerPass = 8; // so a flood cannot starve loop()
+
+    struct Stats
+    {
+        uint32_t packets;
+        uint32_t frames;      // pushed and shown
+        uint32_t dropped;     // a fragment or the push went missing, so never shown
+        uint32_t lostPackets; // sequence numbers skipped
+        uint32_t malformed;   // not DDP, not RGB, not whole pixels, or off the strip
+        uint32_t ignored;     // queries, and packets for other ids
+    };
+
+    static constexpr uint8_t typeMask = 0xB8; // customer-defined bit and data type, not pixel size
+    static constexpr uint8_t typeRgb = 0x08;
+
+    // pixels is the strip's length; data starting past it is malformed
+    void begin(uint16_t port, uint16_t pixels)
+    {
+        udp.begin(port);
+        frameBytes = pixels * 3UL;
+    }
+
+    // Takes the next data packet for the strip off the socket, if there is
+    // one, with its header read and checked; anything else ahead of it is
+    // dropped. Call receive() to handle it once the strip is ready for
+    // stream frames.
+    bool pending()
+    {
+        for (uint8_t i = 0; size <= 0 && i < maxPacketsPerPass; i++)
+        {
+            size = udp.parsePacket();
+            if (size <= 0)
+            {
+                return false;
+            }
+            if (!readHeader())
+            {
+                size = 0;
+            }
+        }
+        return size > 0;
+    }
+
+    // Writes the pending packet and any more data packets waiting into
+    // strip's frame, up to the first whole frame pushed. True if there was
+    // one, to show before the next frame starts writing over it. Only data
+    // packets keep the stream alive; junk on the port does not.
+    bool receive(DirtyStrip &strip, unsigned long now)
+    {
+        bool push = false;
+        for (uint8_t i = 0; i < maxPacketsPerPass && !push && pending(); i++)
+        {
+            push |= take(strip);
+            size = 0;
+            lastPacketAt = now;
+        }
+        return push;
+    }
+
+    // Starts the timeout over, as when the strip switches to the stream and
+    // clears its frame, which counts as whole
+    void restart(unsigned long now)
+    {
+        lastPacketAt = now;
+        damaged = written = torn = false;
+        frameEnd = 0;
+    }
+
+    // True when the strip's frame holds the last whole frame pushed, with
+    // nothing of a later one written over it, so it is safe to show
+    bool frameReady() const { return !written && !torn; }
+
+    unsigned long idleFor(unsigned long now) const { return now - lastPacketAt; }
+
+    const Stats &stats() const { return counts; }
+
+private:
+    // Reads the header of the packet parsePacket() took; true if it is frame
+    // data for the strip
+    bool readHeader()
+    {
+        counts.packets++;
+        uint8_t header[headerBytes];
+        if (size < headerBytes || udp.read(header, headerBytes) != headerBytes || (header[0] & 0xC0) != 0x40)
+        {
+            counts.malformed++;
+            return false;
+        }
+        if ((header[0] & 0x02) || header[3] > 1)
+        {
+            counts.ignored++;
+            return false;
+        }
+        int payload = size - headerBytes;
+        if (header[0] & 0x10)
+        {
+            uint8_t timecode[4];
+            payload = udp.read(timecode, sizeof(timecode)) == sizeof(timecode) ? payload - 4 : -1;
+        }
+        flags = header[0];
+        seq = header[1] & 0x0F;
+        offset = (uint32_t)header[4] << 24 | (uint32_t)header[5] << 16 | header[6] << 8 | header[7];
+        length = header[8] << 8 | header[9];
+        uint8_t type = header[2] & typeMask;
+        if ((type != 0 && type != typeRgb) || offset % 3 || length % 3 || payload < 0 || length > payload ||
+            (length > 0 && offset >= frameBytes))
+        {
+            counts.malformed++;
+            return false;
+        }
+        return true;
+    }
+
+    // Handles the pending packet, whose header readHeader() took; true if it
+    // pushed
+    bool take(DirtyStrip &strip)
+    {
+        if (seq && lastSeq)
+        {
+            uint8_t skipped = (seq + 15 - lastSeq - 1) % 15;
+            counts.lostPackets += skipped;
+            damaged |= skipped != 0;
+        }
+        if (seq)
+        {
+            lastSeq = seq;
+        }
+        if (written && offset < frameEnd)
+        {
+            // A new frame began before the last one was pushed
+            counts.dropped++;
+            damaged = false;
+            torn = true;
+            frameEnd = 0;
+        }
+        damaged |= offset != frameEnd; // a fragment between went missing
+
+        if (offset < frameBytes)
+        {
+            uint8_t *frame = (uint8_t *)strip.frame();
+            uint32_t n = length < frameBytes - offset ? length : frameBytes - offset;
+            n = udp.read(frame + offset, n) / 3 * 3;
+            for (uint8_t *p = frame + offset, *end = p + n; p < end; p += 3)
+            {
+                uint8_t r = p[0];
+                p[0] = p[1];
+                p[1] = r;
+            }
+        }
+        written = true;
+        frameEnd = offset + length;
+
+        if (!(flags & 0x01))
+        {
+            return false;
+        }
+        bool whole = !damaged;
+        damaged = false;
+        written = false;
+        frameEnd = 0;
+        torn = !whole;
+        if (!whole)
+        {
+            counts.dropped++;
+            return false;
+        }
+        counts.frames++;
+        return true;
+    }
+
+    WiFiUDP udp;
+    uint32_t frameBytes = 0;
+    int size = 0; // of the packet pending() took, not yet handled
+
+    // Its header
+    uint8_t flags = 0;
+    uint8_t seq = 0;
+    uint32_t offset = 0;
+    uint16_t length = 0;
+
+    unsigned long lastPacketAt = 0;
+    uint8_t lastSeq = 0;
+    bool damaged = false; // the frame being received has lost a fragment
+    bool written = false; // fragments of it have arrived
+    bool torn = false;    // a dropped frame is partly in the strip's frame
+    uint32_t frameEnd = 0; // past its last fragment so far
+    Stats counts = {};
+};
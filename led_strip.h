@@ -0,0 +1,358 @@
+#pragma once
+// Adafruit_NeoPixel as a render target. Patterns write unscaled colors
+// straight into the pixel buffer (frame(), fill(), span(), blend()) instead of
+// going through setPixelColor() per pixel, and show() applies brightness once,
+// in the same pass that finds what changed.
+//
+// A 300-pixel show() holds interrupts off for about 9 ms, so show() sends
+// nothing when the scaled frame matches what the LEDs already display, and
+// otherwise only the prefix up to the highest changed pixel: WS2812s past the
+// end of a shorter frame keep the color they already latched.
+//
+// With setGammaDither(true), show() also runs each byte through a gamma curve
+// and keeps 16 bits of it through brightness scaling. The fraction that does
+// not fit in the wire byte is carried into that byte on the next show(), so a
+// level between two wire values alternates between them in the right
+// proportion instead of banding. The output stage is still the single pass
+// that produces the wire bytes, but it now runs over the whole frame.
+//
+// Dithering only hides while frames come fast: the residue moves once per
+// show(), so a held level near black blinks at the frame rate divided by
+// however many frames a wire step takes. setDither(false) rounds instead,
+// keeping the gamma curve, for callers that show() too seldom. Each byte's
+// residue starts at its own offset, spread evenly across the strip, so
+// pixels holding the same level take their turns at the upper wire value
+// rather than all blinking together.
+//
+// With useUart(), show() hands the wire bytes to the UART1 driver in
+// led_uart.h instead, which sends them under interrupt and returns at once.
+// A show() while that frame is still going out cannot rewrite them, so it
+// sends nothing and returns false; showPending() stays true until a later
+// show() gets the frame out. Nothing waits on the UART in loop().
+//
+// For transitions, crossfade() makes that same pass mix a second frame into
+// this one, and drawInto() points the drawing calls at that second frame so
+// the outgoing mode can keep rendering into it.
+//
+// The strip must be NEO_GRB: frame() hands out the buffer in wire order.
+#include <Adafruit_NeoPixel.h>
+#include "led_gamma.h"
+#include "led_uart.h"
+
+// One pixel in NEO_GRB wire order
+struct Grb
+{
+    uint8_t g, r, b;
+};
+
+constexpr Grb grb(uint8_t r, uint8_t g, uint8_t b)
+{
+    return {g, r, b};
+}
+
+// From a packed 0xRRGGBB color as returned by Color() and colorHSV()
+constexpr Grb grb(uint32_t c)
+{
+    return {(uint8_t)(c >> 8), (uint8_t)(c >> 16), (uint8_t)c};
+}
+
+constexpr bool operator==(Grb a, Grb b)
+{
+    return a.g == b.g && a.r == b.r && a.b == b.b;
+}
+
+constexpr bool operator!=(Grb a, Grb b)
+{
+    return !(a == b);
+}
+
+class DirtyStrip : public Adafruit_NeoPixel
+{
+public:
+    // The base class never gets a brightness, so its buffer holds the
+    // colors exactly as the patterns wrote them
+    DirtyStrip(uint16_t n, int16_t pin, neoPixelType type)
+        : Adafruit_NeoPixel(n, pin, type), wire((uint8_t *)calloc(n, 3))
+    {
+        if (!wire)
+        {
+            Adafruit_NeoPixel::updateLength(0);
+        }
+    }
+
+    ~DirtyStrip()
+    {
+        free(wire);
+        free(residue);
+    }
+
+    // For a length only known at runtime; clears the frame, and the next
+    // show() sends the whole strip. Without the RAM for it the strip is left
+    // with no pixels, as the library leaves it when its own buffer fails,
+    // and with dithering off.
+    void updateLength(uint16_t n)
+    {
+        if (uart)
+        {
+            uart->waitIdle();
+        }
+        Adafruit_NeoPixel::updateLength(n);
+        free(wire);
+        wire = (uint8_t *)calloc(numBytes, 1);
+        if (!wire)
+        {
+            Adafruit_NeoPixel::updateLength(0);
+        }
+        if (residue)
+        {
+            free(residue);
+            residue = (uint8_t *)malloc(numBytes);
+            seedResidue();
+        }
+        sendAll = true;
+    }
+
+    // Sends frames through uart rather than bit-banging the data pin; call
+    // before begin()
+    void useUart(Ws2812Uart1 &out) { uart = &out; }
+
+    // The LEDs may still hold colors from before a restart, so the first
+    // show() after begin() always sends the whole strip
+    void begin()
+    {
+        if (uart)
+        {
+            uart->begin();
+        }
+        else
+        {
+            Adafruit_NeoPixel::begin();
+        }
+        sendAll = true;
+    }
+
+    // False if the UART was still sending the last frame, and this one
+    // is left pending
+    bool show()
+    {
+        if (uart && uart->busy())
+        {
+            pending = true; // it is still reading wire
+            return false;
+        }
+        pending = false;
+        // Produce the wire bytes and find the highest one that changed in
+        // the same pass
+        uint16_t changed = 0;
+        for (uint16_t i = 0; i < numBytes; i++)
+        {
+            uint8_t out = !residue ? scale(source(i)) : dithering ? dither(i) : (level16(source(i)) + 128) >> 8;
+            if (out != wire[i])
+            {
+                wire[i] = out;
+                changed = i + 1;
+            }
+        }
+        uint16_t end = sendAll ? numLEDs : (changed + 2) / 3;
+        sendAll = false;
+        if (end == 0)
+        {
+            return true;
+        }
+        if (uart)
+        {
+            uart->send(wire, end * 3);
+            return true;
+        }
+        // The library clocks out numBytes from pixels; point it at the prefix
+        uint8_t *frameBytes = pixels;
+        uint16_t fullBytes = numBytes;
+        pixels = wire;
+        numBytes = end * 3;
+        Adafruit_NeoPixel::show();
+        pixels = frameBytes;
+        numBytes = fullBytes;
+        return true;
+    }
+
+    // A frame show() could not send yet
+    bool showPending() const { return pending; }
+
+    // show(), waiting for the UART if it is busy; for setup and restart
+    void showNow()
+    {
+        if (uart)
+        {
+            uart->waitIdle();
+        }
+        show();
+    }
+
+    // Sends the whole frame whether or not it changed
+    void showAll()
+    {
+        sendAll = true;
+        show();
+    }
+
+    // One past the highest pixel whose frame differs from what the LEDs
+    // show, or 0. With dithering, a wire byte on either side of its exact
+    // level still counts as showing it. Scans from the top, so it stops
+    // early on frames that changed there.
+    uint16_t changedEnd() const
+    {
+        for (uint16_t i = numBytes; i > 0; i--)
+        {
+            uint8_t w = wire[i - 1];
+            uint8_t v = source(i - 1);
+            bool shown;
+            if (!residue)
+            {
+                shown = w == scale(v);
+            }
+            else if (dithering)
+            {
+                shown = w >= level16(v) >> 8 && w <= (level16(v) + 255) >> 8;
+            }
+            else
+            {
+                shown = w == (level16(v) + 128) >> 8;
+            }
+            if (!shown)
+            {
+                return (i + 2) / 3;
+            }
+        }
+        return 0;
+    }
+
+    // Until called again with from = nullptr, show() displays from mixed
+    // toward this frame by alpha / 256 (0..256). from is a frame of the same
+    // length in wire order.
+    void crossfade(const uint8_t *from, uint16_t alpha)
+    {
+        fadeFrom = from;
+        fadeAlpha = alpha;
+    }
+
+    // Points frame(), fill(), span() and blend() at another buffer of the
+    // same length and returns the one they used before
+    uint8_t *drawInto(uint8_t *buf)
+    {
+        uint8_t *previous = pixels;
+        pixels = buf;
+        return previous;
+    }
+
+    // Turns the gamma and dithering stage on or off; the next show() resends
+    // the frame. False if there was no RAM to turn it on, which leaves it off.
+    bool setGammaDither(bool on)
+    {
+        free(residue);
+        residue = on ? (uint8_t *)malloc(numBytes) : nullptr;
+        seedResidue();
+        sendAll = true;
+        return residue || !on;
+    }
+
+    // With the gamma stage on, whether show() dithers (the default) or
+    // rounds each byte to the nearest wire value; takes effect from the next
+    // show() and allocates nothing, so it can follow the frame rate
+    void setDither(bool on) { dithering = on; }
+    bool ditherOn() const { return residue && dithering; }
+
+    // Applied by show(); changing it makes the next show() resend the frame
+    void setBrightness(uint8_t b) { level = b + 1; }
+    uint8_t getBrightness() const { return level - 1; }
+
+    Grb *frame() { return (Grb *)pixels; }
+
+    void fill(Grb c, uint16_t first = 0, uint16_t count = 0)
+    {
+        Grb *p = frame() + min(first, numLEDs);
+        Grb *end = (count == 0 || first + count > numLEDs) ? frame() + numLEDs : p + count;
+        while (p < end)
+        {
+            *p++ = c;
+        }
+    }
+
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0)
+    {
+        fill(grb(c), first, count);
+    }
+
+    // Copies count pixels from src to first, clipped to the strip
+    void span(uint16_t first, const Grb *src, uint16_t count)
+    {
+        if (first >= numLEDs)
+        {
+            return;
+        }
+        memcpy(frame() + first, src, min(count, (uint16_t)(numLEDs - first)) * sizeof(Grb));
+    }
+
+    // Mixes c over count pixels from first; alpha 255 is (almost) all c
+    void blend(uint16_t first, uint16_t count, Grb c, uint8_t alpha)
+    {
+        Grb *p = frame() + min(first, numLEDs);
+        Grb *end = first + count > numLEDs ? frame() + numLEDs : p + count;
+        for (; p < end; p++)
+        {
+            p->g += ((c.g - p->g) * alpha) >> 8;
+            p->r += ((c.r - p->r) * alpha) >> 8;
+            p->b += ((c.b - p->b) * alpha) >> 8;
+        }
+    }
+
+private:
+    // Adafruit's brightness math: level is brightness + 1, and 0 means full
+    uint8_t scale(uint8_t v) const { return level ? (v * level) >> 8 : v; }
+
+    // Frame byte i as it should be displayed, before brightness
+    uint8_t source(uint16_t i) const
+    {
+        if (!fadeFrom)
+        {
+            return pixels[i];
+        }
+        int from = fadeFrom[i];
+        return from + (((pixels[i] - from) * (int)fadeAlpha) >> 8);
+    }
+
+    // Gamma-corrected and brightness-scaled, 8.8 fixed point
+    uint16_t level16(uint8_t v) const
+    {
+        uint16_t g = gamma16(v);
+        return level ? ((uint32_t)g * level) >> 8 : g;
+    }
+
+    // Byte i starts owed the fractional part of i times the golden ratio: a
+    // level needing k frames per wire step lights about 1 / k of any run of
+    // bytes on each show(), not all of them on one show() in k
+    void seedResidue()
+    {
+        for (uint16_t i = 0; residue && i < numBytes; i++)
+        {
+            residue[i] = (uint32_t)i * 2654435769u >> 24;
+        }
+    }
+
+    // The wire byte for frame byte i, carrying its dropped fraction forward
+    uint8_t dither(uint16_t i)
+    {
+        uint16_t acc = level16(source(i)) + residue[i];
+        residue[i] = (uint8_t)acc;
+        return acc >> 8;
+    }
+
+    uint8_t *wire;              // scaled bytes as the LEDs currently display them
+    uint8_t *residue = nullptr; // fraction each byte is still owed, with the gamma stage on
+    bool dithering = true;      // else show() rounds
+    const uint8_t *fadeFrom = nullptr; // outgoing frame while crossfading
+    uint16_t fadeAlpha = 0;
+    uint16_t level = 0;
+    bool sendAll = false;
+    bool pending = false; // show() found the UART busy
+    Ws2812Uart1 *uart = nullptr; // sends frames instead of the library, when set
+};
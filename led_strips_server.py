@@ -1,12 +1,45 @@
-from flask import Flask, jsonify, request, render_template
+from flask import Flask, jsonify, request, render_template, make_response
+from werkzeug.serving import WSGIRequestHandler
 import json
 import os
+import socket
+import struct
+import threading
+import time
 
 app = Flask(__name__)
 
 # File to store the JSON data
 json_file_path = 'data.json'
 
+# Longest a /mode request may be held waiting for a change
+MAX_WAIT_SECONDS = 30
+
+# Woken by /update, so held /mode requests answer at once
+mode_changed = threading.Condition()
+
+# Mode changes are also pushed over UDP to every strip that fetched /mode
+# lately (led_modepush.h), resent until the strip acks. Strip lengths go
+# out the same way, as only the strips can store them.
+STRIP_PUSH_PORT = 4210
+PUSH_RETRY_SECONDS = 0.1
+PUSH_TRIES = 20
+STRIP_FORGET_SECONDS = 600
+strips = {}  # address -> time.monotonic() of its last /mode request
+strips_lock = threading.Lock()
+# Sequence numbers start from the clock so they keep rising across restarts
+push_seq = int(time.time() * 1000) & 0xFFFFFFFF
+# So does the mode's version, which rises with each /update. It leads the
+# /mode ETag and rides along in mode pushes, so a strip can drop a push
+# older than the mode it already shows.
+mode_version = push_seq
+PUSH_MODE = 1
+PUSH_LENGTH = 3
+
+# Strip lengths led_sketch accepts (led_length.h)
+MIN_STRIP_LENGTH = 20
+MAX_STRIP_LENGTH = 1200
+
 VALID_MODES = [
     'off',
     'rainbow-flow',
@@ -55,22 +88,92 @@ def write_json(data):
     with open(json_file_path, 'w') as f:
         json.dump(data, f)
 
-# Route to serve the current mode as plain text
+def push_mode(mode, version):
+    push(PUSH_MODE, struct.pack('<I', version) + mode.encode())
+
+def push_length(length):
+    return push(PUSH_LENGTH, struct.pack('<H', length))
+
+# Sends a push to every strip seen lately and returns how many that was
+def push(kind, payload):
+    global push_seq
+    with strips_lock:
+        push_seq = (push_seq + 1) & 0xFFFFFFFF
+        datagram = b'LM' + bytes([kind]) + struct.pack('<I', push_seq) + payload
+        now = time.monotonic()
+        targets = [address for address, seen in strips.items() if now - seen < STRIP_FORGET_SECONDS]
+    for address in targets:
+        threading.Thread(target=push_to, args=(address, datagram), daemon=True).start()
+    return len(targets)
+
+def push_to(address, datagram):
+    ack = b'LM\x02' + datagram[3:7]
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(PUSH_RETRY_SECONDS)
+        for _ in range(PUSH_TRIES):
+            sock.sendto(datagram, (address, STRIP_PUSH_PORT))
+            try:
+                while not sock.recv(16).startswith(ack):
+                    pass
+                return
+            except socket.timeout:
+                pass
+    print(f"No ack from {address} for push")
+
+# The ETag carries the mode as well as its version, so a hand edit to
+# data.json still changes it
+def mode_etag(mode):
+    return f'{mode_version}-{mode}'
+
+# Route to serve the current mode as plain text. A request whose
+# If-None-Match still matches the ETag gets 304, after waiting up to ?wait=
+# seconds for the mode to change (a long-poll).
 @app.route('/mode', methods=['GET'])
 def get_mode():
-    data = read_json()
-    return data['mode']
+    with strips_lock:
+        strips[request.remote_addr] = time.monotonic()
+    mode = read_json()['mode']
+    wait = min(request.args.get('wait', 0, type=float), MAX_WAIT_SECONDS)
+    if wait > 0 and request.if_none_match.contains(mode_etag(mode)):
+        deadline = time.monotonic() + wait
+        with mode_changed:
+            while request.if_none_match.contains(mode_etag(mode)):
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                # Recheck every second too, in case data.json was edited by hand
+                mode_changed.wait(min(remaining, 1.0))
+                mode = read_json()['mode']
+    response = make_response(mode)
+    response.set_etag(mode_etag(mode))
+    return response.make_conditional(request)
 
 # Route to update the mode in the JSON file
 @app.route('/update', methods=['POST'])
 def update_data():
     new_mode = request.json.get('mode')
+    global mode_version
     if new_mode in VALID_MODES:
-        write_json({'mode': new_mode})
+        with mode_changed:
+            write_json({'mode': new_mode})
+            mode_version = (mode_version + 1) & 0xFFFFFFFF
+            version = mode_version
+            mode_changed.notify_all()
+        push_mode(new_mode, version)
         return jsonify({'message': 'Mode updated successfully!'}), 200
     else:
         return jsonify({'error': f'Invalid mode. Choose from {VALID_MODES}.'}), 400
 
+# Route to set the strip length: each strip stores it and restarts at it. Only
+# strips that fetched /mode in the last STRIP_FORGET_SECONDS get it.
+@app.route('/length', methods=['POST'])
+def update_length():
+    length = request.json.get('length')
+    if not isinstance(length, int) or not MIN_STRIP_LENGTH <= length <= MAX_STRIP_LENGTH:
+        return jsonify({'error': f'Length must be {MIN_STRIP_LENGTH} to {MAX_STRIP_LENGTH} LEDs.'}), 400
+    sent = push_length(length)
+    return jsonify({'message': f'Length {length} pushed to {sent} strip(s).'}), 200
+
 # Route to render the HTML page
 @app.route('/')
 def index():
@@ -78,5 +181,7 @@ def index():
     return render_template('index.html', mode=data['mode'], valid_modes=VALID_MODES)
 
 if __name__ == '__main__':
+    # HTTP/1.1 so strips can keep their connection open between /mode requests
+    WSGIRequestHandler.protocol_version = 'HTTP/1.1'
     # debug=False: avoid the reloader (extra process / dropped connections) for long-running ESP clients
     app.run(debug=False, host='0.0.0.0', port=5000, threaded=True)
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+// Fixed-point sine/cosine for the pattern loops. The ESP8266 has no FPU, so a
+// soft-float sin() per pixel is the most expensive thing a mode can do.
+//
+// Phases are 32-bit fractions of a turn: 0x40000000 is 90 degrees and the
+// accumulator wraps exactly once per revolution, so "x radians" becomes
+// x * trigRate(1) with plain integer multiplies and adds. The top 10 bits index
+// a 1024-entry table in flash and the next 16 bits interpolate between entries,
+// which keeps sin16() within 1 LSB of the exact Q15 sine (make -C host trig
+// sweeps it). The table is computed by the compiler, like the palettes.
+#include <Arduino.h>
+
+constexpr uint8_t sinTableBits = 10;
+
+struct SinTable
+{
+    int16_t entry[(1 << sinTableBits) + 1]; // last entry repeats the first
+};
+
+// sin(x) for |x| <= pi/2 from its Taylor series, for tabulating at compile time
+constexpr double taylorSin(double x)
+{
+    double term = x;
+    double sum = x;
+    for (int k = 1; k < 12; k++)
+    {
+        term *= -x * x / ((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// round(32767 * sin(2*pi*k/1024)), each entry folded into the first quarter turn
+constexpr SinTable makeSinTable()
+{
+    constexpr int half = 1 << (sinTableBits - 1);
+    constexpr double pi = 3.14159265358979323846;
+    SinTable t{};
+    for (int k = 0; k <= 2 * half; k++)
+    {
+        int q = k % half;
+        int m = q <= half / 2 ? q : half - q;
+        int16_t v = (int16_t)(32767 * taylorSin(m * pi / half) + 0.5);
+        t.entry[k] = k % (2 * half) < half ? v : -v;
+    }
+    return t;
+}
+
+inline constexpr SinTable sinTable PROGMEM = makeSinTable();
+
+// Phase step for a given angle in radians, e.g. trigRate(0.05) for sin(x * 0.05f)
+constexpr uint32_t trigRate(double radians)
+{
+    return (uint32_t)(radians / (2.0 * 3.14159265358979323846) * 4294967296.0 + 0.5);
+}
+
+// sin() of a turn phase, Q15 (-32767..32767)
+inline int16_t sin16(uint32_t phase)
+{
+    uint16_t idx = phase >> (32 - sinTableBits);
+    int32_t a = (int16_t)pgm_read_word(&sinTable.entry[idx]);
+    int32_t b = (int16_t)pgm_read_word(&sinTable.entry[idx + 1]);
+    int32_t frac = (phase >> (16 - sinTableBits)) & 0xFFFF;
+    return (int16_t)(a + (((b - a) * frac + 0x8000) >> 16));
+}
+
+inline int16_t cos16(uint32_t phase)
+{
+    return sin16(phase + 0x40000000u);
+}
+
+// (sin + 1) / 2 as a Q16 blend factor (1..65535), the form the modes mix colors with
+inline uint16_t sinBlend16(uint32_t phase)
+{
+    return (uint16_t)(sin16(phase) + 32768);
+}
+
+inline uint16_t cosBlend16(uint32_t phase)
+{
+    return (uint16_t)(cos16(phase) + 32768);
+}
+
+// value * blend, for blend in Q16; truncates like the float (uint8_t) casts it replaces
+inline uint32_t scaleBlend16(uint32_t value, uint16_t blend)
+{
+    return (value * blend) >> 16;
+}
@@ -0,0 +1,144 @@
+#pragma once
+// WS2812 output through UART1, whose TX pin is GPIO2 on the ESP-01. The
+// library's show() bit-bangs the pin with interrupts off for the whole frame,
+// about 9 ms at 300 pixels, which starves the WiFi stack. Here each pair of
+// wire bits becomes one UART symbol, and the TX FIFO is refilled from an
+// interrupt as it drains, so send() returns at once and the next frame
+// renders while this one goes out.
+//
+// At 3.2 Mbaud a UART bit lasts 312.5 ns, a quarter of a WS2812 bit. A 6N1
+// symbol is 8 UART bits: start, six data bits (LSB first), stop. With TX
+// inverted, the start bit drives the line high and the stop bit low, so a
+// symbol is two WS2812 bits: high for one quarter then low ("0"), or high for
+// three quarters then low ("1"). The line idles low, which is the WS2812
+// latch.
+//
+// UART0 and UART1 share one interrupt, so Serial must be begun TX only, or
+// its receive interrupt handler would be replaced.
+#include <Arduino.h>
+#include <ets_sys.h>
+
+// The UART symbol for two wire bits, given high bit first as 0..3
+static const uint8_t ws2812Symbol[4] = {
+    0b110111, // line 1 000 100 0: "0" "0"
+    0b000111, // line 1 000 111 0: "0" "1"
+    0b110100, // line 1 110 100 0: "1" "0"
+    0b000100, // line 1 110 111 0: "1" "1"
+};
+
+// Writes the four UART symbols for one wire byte, most significant bits first
+inline void IRAM_ATTR ws2812Encode(uint8_t byte, uint8_t *symbols)
+{
+    symbols[0] = ws2812Symbol[byte >> 6];
+    symbols[1] = ws2812Symbol[(byte >> 4) & 3];
+    symbols[2] = ws2812Symbol[(byte >> 2) & 3];
+    symbols[3] = ws2812Symbol[byte & 3];
+}
+
+class Ws2812Uart1
+{
+public:
+    static constexpr uint32_t baud = 3200000;
+    static constexpr uint8_t fifoSize = 128;
+    static constexpr uint8_t refillBelow = 32; // symbols left when the interrupt refills
+    static constexpr uint16_t latchMicros = 300; // low time before the next frame; WS2812B needs 280
+
+    // Puts GPIO2 on UART1 TX at 3.2 Mbaud 6N1, inverted
+    void begin()
+    {
+        pinMode(2, SPECIAL);
+        USD(UART1) = ESP8266_CLOCK / baud;
+        USC0(UART1) = (1 << UCBN) | (1 << UCBS) | (1 << UCTXI); // 6 data bits, 1 stop bit
+        USC0(UART1) |= 1 << UCTXRST;
+        USC0(UART1) &= ~(1 << UCTXRST);
+        USC1(UART1) = refillBelow << UCFET;
+        USIE(UART1) = 0;
+        USIC(UART1) = 0xFFFF;
+        ETS_UART_INTR_ATTACH(onInterrupt, this);
+        ETS_UART_INTR_ENABLE();
+        idleSince = micros();
+    }
+
+    // True until the last frame is out and the LEDs have latched it
+    bool busy()
+    {
+        if (next != end || txCount() != 0)
+        {
+            draining = true;
+            return true;
+        }
+        if (draining)
+        {
+            // First seen idle; the line has been low at least since now
+            draining = false;
+            idleSince = micros();
+        }
+        return micros() - idleSince < latchMicros;
+    }
+
+    void waitIdle()
+    {
+        while (busy())
+        {
+            delayMicroseconds(20);
+        }
+    }
+
+    // Starts sending count bytes and returns; bytes must stay as they are
+    // until busy() is false. Waits for any frame still going out, so check
+    // busy() first where waiting would stall the caller.
+    void send(const uint8_t *bytes, uint16_t count)
+    {
+        waitIdle();
+        next = bytes;
+        end = bytes + count;
+        draining = true;
+        fill();
+        if (next != end)
+        {
+            USIC(UART1) = 1 << UIFE;
+            USIE(UART1) |= 1 << UIFE;
+        }
+    }
+
+private:
+    static uint8_t txCount() { return (USS(UART1) >> USTXC) & 0xFF; }
+
+    // Tops the FIFO up with whole bytes' worth of symbols
+    void IRAM_ATTR fill()
+    {
+        uint8_t room = (fifoSize - txCount()) / 4;
+        const uint8_t *stop = end - next > room ? next + room : end;
+        uint8_t symbols[4];
+        while (next < stop)
+        {
+            ws2812Encode(*next++, symbols);
+            USF(UART1) = symbols[0];
+            USF(UART1) = symbols[1];
+            USF(UART1) = symbols[2];
+            USF(UART1) = symbols[3];
+        }
+    }
+
+    static void IRAM_ATTR onInterrupt(void *arg)
+    {
+        Ws2812Uart1 *self = static_cast<Ws2812Uart1 *>(arg);
+        uint32_t uart0 = USIS(UART0);
+        uint32_t uart1 = USIS(UART1);
+        if (uart1 & (1 << UIFE))
+        {
+            self->fill();
+            if (self->next == self->end)
+            {
+                USIE(UART1) &= ~(1 << UIFE);
+            }
+        }
+        USIC(UART0) = uart0;
+        USIC(UART1) = uart1;
+    }
+
+    const uint8_t *volatile next = nullptr;
+    const uint8_t *end = nullptr;
+    bool draining = false; // a frame was going out when last checked
+    uint32_t idleSince = 0;
+};
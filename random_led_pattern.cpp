@@ -1,6 +1,7 @@
 #include <ESP8266WiFi.h>
-#include <Adafruit_NeoPixel.h>
 #include <ArduinoJson.h>
+#include "led_strip.h"
+#include "led_statestream.h"
 
 // Wi-Fi credentials
 const char* ssid = "BrubakerWifi";
@@ -9,17 +10,27 @@ const char* password = "Pre$ton01";
 // Server details
 IPAddress serverIP(192, 168, 1, 180);
 const int serverPort = 6011;
+// Streams states bit-packed over one connection (see led_statestream.h);
+// while it cannot be reached the strip polls serverPort for one at a time
+const uint16_t streamPort = 6012;
+const uint16_t streamTimeoutMs = 1000;
+const uint16_t streamRetryMs = 10000;
 
 // LED strip configuration
 #define NUM_LEDS 300
 #define DATA_PIN 2 // GPIO2
 #define BRIGHTNESS 50 // 0-255
-Adafruit_NeoPixel strip = Adafruit_NeoPixel(NUM_LEDS, DATA_PIN, NEO_GRB + NEO_KHZ800);
+DirtyStrip strip = DirtyStrip(NUM_LEDS, DATA_PIN, NEO_GRB + NEO_KHZ800);
 
 // Polling timing
 unsigned long lastPoll = 0;
 const unsigned long pollInterval = 10; // Poll every 10ms for quick updates
 
+StateStream stateStream;
+const unsigned long streamLogInterval = 10000;
+unsigned long lastStreamLog = 0;
+uint32_t lastStreamStates = 0;
+
 // Cursor for updating LEDs
 int cursor = 0;
 
@@ -43,6 +54,8 @@ void setup() {
     }
     Serial.println("Connected to WiFi");
     Serial.println("IP address: " + WiFi.localIP().toString());
+
+    stateStream.begin(serverIP, streamPort, streamTimeoutMs, streamRetryMs);
 }
 
 void loop() {
@@ -54,24 +67,52 @@ void loop() {
         return;
     }
 
+    unsigned long now = millis();
+    // Everything that has arrived goes out in one show(); while show() runs,
+    // more arrives, so a slow strip takes bigger batches rather than lagging
+    if (stateStream.poll(now, paintState)) {
+        strip.show();
+    }
+    if (stateStream.connected()) {
+        logStream(now);
+        return;
+    }
+
     // Poll server for state updates
     if (millis() - lastPoll >= pollInterval) {
         int state = getStateFromServer();
         if (state >= 0) {
-            uint32_t color;
-            if (state == 1) {
-                color = strip.Color(255, 0, 0); // Red for 1
-            } else {
-                color = strip.Color(173, 216, 230); // Light blue for 0
-            }
-            strip.setPixelColor(cursor, color);
+            paintState(state);
             strip.show();
-            cursor = (cursor + 1) % NUM_LEDS;
         }
         lastPoll = millis();
     }
 }
 
+// Colors the pixel at the cursor for one state and moves the cursor on
+void paintState(uint8_t state) {
+    uint32_t color;
+    if (state == 1) {
+        color = strip.Color(255, 0, 0); // Red for 1
+    } else {
+        color = strip.Color(173, 216, 230); // Light blue for 0
+    }
+    strip.setPixelColor(cursor, color);
+    cursor = (cursor + 1) % NUM_LEDS;
+}
+
+void logStream(unsigned long now) {
+    if (now - lastStreamLog < streamLogInterval) {
+        return;
+    }
+    const StateStream::Stats &s = stateStream.stats();
+    Serial.printf("State stream: %.0f states/s, %u reconnects\n",
+                  (s.states - lastStreamStates) * 1000.0f / (now - lastStreamLog),
+                  s.connects - 1);
+    lastStreamLog = now;
+    lastStreamStates = s.states;
+}
+
 int getStateFromServer() {
     WiFiClient client;
     if (!client.connect(serverIP, serverPort)) {
@@ -109,7 +150,5 @@ int getStateFromServer() {
 }
 
 void setLedsOff() {
-    for (int i = 0; i < NUM_LEDS; i++) {
-        strip.setPixelColor(i, strip.Color(0, 0, 0));
-    }
+    strip.fill(grb(0, 0, 0));
 }